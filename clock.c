@@ -1,6 +1,6 @@
 /* 
- * clock.c - Routines for using the cycle counters on x86, 
- *           Alpha, and Sparc boxes.
+ * clock.c - Routines for using the cycle counters on x86, x86-64,
+ *           AArch64, Alpha, and Sparc boxes.
  * 
  * Copyright (c) 2002, R. Bryant and D. O'Hallaron, All rights reserved.
  * May not be used, modified, or copied without permission.
@@ -8,15 +8,23 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 #include <unistd.h>
 #include <sys/times.h>
 #include "clock.h"
 
+#if defined(__i386__) || defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+/* Calibrate constant-rate counters over this many seconds */
+#define CALIB_SECS 0.1
+
 
 /******************************************************* 
  * Machine dependent functions 
  *
- * Note: the constants __i386__ and  __alpha
+ * Note: the constants __i386__, __x86_64__, __aarch64__ and  __alpha
  * are set by GCC when it calls the C preprocessor
  * You can verify this for yourself using gcc -v.
  *******************************************************/
@@ -71,6 +79,118 @@ double get_counter()
 }
 /* $end x86cyclecounter */
 
+#elif defined(__x86_64__)
+/*********************************************************
+ * x86-64 versions of start_counter() and get_counter()
+ *
+ * Reads are serialized so that the measured interval holds exactly
+ * the instructions between the two calls: "lfence" keeps rdtsc from
+ * executing before earlier instructions have completed, and the
+ * "rdtscp; lfence" at the end keeps later instructions from starting
+ * before the counter has been read.
+ *********************************************************/
+
+static unsigned cyc_hi = 0;
+static unsigned cyc_lo = 0;
+static int have_rdtscp = -1; /* Does the CPU have rdtscp? (-1: unknown) */
+
+/* Read the counter once all earlier instructions have completed. */
+void access_counter(unsigned *hi, unsigned *lo)
+{
+    asm volatile("lfence; rdtsc" : "=a" (*lo), "=d" (*hi) : : "memory");
+}
+
+/* Read the counter before any later instruction starts. */
+static void access_counter_end(unsigned *hi, unsigned *lo)
+{
+    unsigned aux;
+
+    if (have_rdtscp)
+	asm volatile("rdtscp; lfence"
+		     : "=a" (*lo), "=d" (*hi), "=c" (aux) : : "memory");
+    else
+	asm volatile("lfence; rdtsc; lfence"
+		     : "=a" (*lo), "=d" (*hi) : : "memory");
+}
+
+/* Record the current value of the cycle counter. */
+void start_counter()
+{
+    if (have_rdtscp < 0) {
+	unsigned eax, ebx, ecx, edx;
+
+	have_rdtscp = __get_cpuid(0x80000001, &eax, &ebx, &ecx, &edx) &&
+	    (edx & (1u << 27));
+    }
+    access_counter(&cyc_hi, &cyc_lo);
+}
+
+/* Return the number of cycles since the last call to start_counter. */
+double get_counter()
+{
+    unsigned ncyc_hi, ncyc_lo;
+    unsigned hi, lo, borrow;
+    double result;
+
+    /* Get cycle counter */
+    access_counter_end(&ncyc_hi, &ncyc_lo);
+
+    /* Do double precision subtraction */
+    lo = ncyc_lo - cyc_lo;
+    borrow = lo > ncyc_lo;
+    hi = ncyc_hi - cyc_hi - borrow;
+    result = (double) hi * (1 << 30) * 4 + lo;
+    if (result < 0) {
+	fprintf(stderr, "Error: counter returns neg value: %.0f\n", result);
+    }
+    return result;
+}
+
+#elif defined(__aarch64__)
+/*********************************************************
+ * AArch64 versions of start_counter() and get_counter()
+ *
+ * These read the generic timer's virtual count, cntvct_el0, which
+ * ticks at the constant rate in cntfrq_el0 rather than at the core
+ * clock. The "isb" keeps the read from being executed ahead of the
+ * instructions before it.
+ *********************************************************/
+
+static unsigned long cyc_start = 0;
+
+/* Read the 64-bit virtual counter. */
+static unsigned long read_cntvct(void)
+{
+    unsigned long val;
+
+    asm volatile("isb; mrs %0, cntvct_el0" : "=r" (val) : : "memory");
+    return val;
+}
+
+/* Set *hi and *lo to the high and low order bits of the counter. */
+void access_counter(unsigned *hi, unsigned *lo)
+{
+    unsigned long val = read_cntvct();
+
+    *hi = (unsigned)(val >> 32);
+    *lo = (unsigned)val;
+}
+
+/* Record the current value of the counter. */
+void start_counter()
+{
+    cyc_start = read_cntvct();
+}
+
+/* Return the number of ticks since the last call to start_counter. */
+double get_counter()
+{
+    unsigned long now = read_cntvct();
+
+    asm volatile("isb" : : : "memory");
+    return (double)(now - cyc_start);
+}
+
 #elif defined(__alpha)
 
 /****************************************************
@@ -179,13 +299,68 @@ double ovhd()
     return result;
 }
 
+/*
+ * counter_is_constant - Does the counter tick at a constant rate,
+ *     whatever the core's frequency and power state? On x86 this is
+ *     the "invariant TSC" bit of cpuid leaf 0x80000007; the AArch64
+ *     generic timer always runs at a fixed frequency.
+ */
+int counter_is_constant(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+    unsigned eax, ebx, ecx, edx;
+
+    return __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) &&
+	(edx & (1u << 8));
+#elif defined(__aarch64__)
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+/*
+ * calibrate_constant - Measure the rate (in MHz) of a constant-rate
+ *     counter against CLOCK_MONOTONIC over CALIB_SECS seconds
+ */
+static double calibrate_constant(void)
+{
+    struct timespec ts0, ts1;
+    double secs, cycles;
+
+#if defined(__aarch64__)
+    unsigned long freq;
+
+    /* The architecture reports the timer's frequency directly */
+    asm volatile("mrs %0, cntfrq_el0" : "=r" (freq));
+    if (freq != 0)
+	return freq / 1e6;
+#endif
+    clock_gettime(CLOCK_MONOTONIC, &ts0);
+    start_counter();
+    do {
+	clock_gettime(CLOCK_MONOTONIC, &ts1);
+	secs = (ts1.tv_sec - ts0.tv_sec) + 1e-9 * (ts1.tv_nsec - ts0.tv_nsec);
+    } while (secs < CALIB_SECS);
+    cycles = get_counter();
+    return cycles / (1e6*secs);
+}
+
 /* $begin mhz */
 /* Estimate the clock rate by measuring the cycles that elapse */ 
-/* while sleeping for sleeptime seconds */
+/* while sleeping for sleeptime seconds. A counter with a constant */
+/* rate is instead calibrated against the monotonic clock, which is */
+/* both quicker and unaffected by frequency scaling. */
 double mhz_full(int verbose, int sleeptime)
 {
     double rate;
 
+    if (counter_is_constant()) {
+	rate = calibrate_constant();
+	if (verbose)
+	    printf("Constant-rate counter ~= %.1f MHz\n", rate);
+	return rate;
+    }
     start_counter();
     sleep(sleeptime);
     rate = get_counter() / (1e6*sleeptime);
@@ -15,6 +15,9 @@ double mhz(int verbose);
 /* Determine clock rate of processor, having more control over accuracy */
 double mhz_full(int verbose, int sleeptime);
 
+/* Does the counter tick at a constant rate (e.g., an invariant TSC)? */
+int counter_is_constant(void);
+
 /** Special counters that compensate for timer interrupt overhead */
 
 void start_comp_counter();
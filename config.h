@@ -52,6 +52,16 @@
   */
 #define UTIL_WEIGHT .40
 
+/*
+ * These constants determine when a run counts as a regression against
+ * a baseline file (-b). A throughput drop is reported only when the
+ * mean drop over the traces exceeds REGRESS_THRUPUT and is significant
+ * at the 95% level given the trace-to-trace variation. A utilization
+ * drop of more than REGRESS_UTIL on any trace is always reported.
+ */
+#define REGRESS_THRUPUT .05
+#define REGRESS_UTIL    .01
+
 /* 
  * Alignment requirement in bytes
  */
@@ -65,8 +75,10 @@
 /*****************************************************************************
  * Set exactly one of these USE_xxx constants to "1" to select a timing method
  *****************************************************************************/
-#define USE_FCYC   0   /* cycle counter w/K-best scheme (x86 & Alpha only) */
+#define USE_FCYC   0   /* cycle counter w/K-best scheme (x86, x86-64, */
+                       /* AArch64 & Alpha only) */
 #define USE_ITIMER 0   /* interval timer (any Unix box) */
-#define USE_GETTOD 1   /* gettimeofday (any Unix box) */
+#define USE_GETTOD 0   /* gettimeofday (any Unix box) */
+#define USE_CLOCK  1   /* clock_gettime w/adaptive median (POSIX boxes) */
 
 #endif /* __CONFIG_H */
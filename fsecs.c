@@ -9,6 +9,7 @@
 #include "config.h"
 
 static double Mhz;  /* estimated CPU clock frequency */
+static int reps = 0; /* fixed number of timed runs, or 0 for the default */
 
 extern int verbose; /* -v option in mdriver.c */
 
@@ -29,6 +30,10 @@ void init_fsecs(void)
     set_fcyc_compensate(1);
     set_fcyc_epsilon(0.01);
     set_fcyc_k(3);
+    if (reps) {
+	set_fcyc_maxsamples(reps);
+	set_fcyc_k(reps < 3 ? reps : 3);
+    }
     Mhz = mhz(verbose > 0);
 #elif USE_ITIMER
     if (verbose)
@@ -36,22 +41,58 @@ void init_fsecs(void)
 #elif USE_GETTOD
     if (verbose)
 	printf("Measuring performance with gettimeofday().\n");
+#elif USE_CLOCK
+    if (verbose)
+	printf("Measuring performance with clock_gettime().\n");
+    set_ftimer_clock_samples(reps);
 #endif
 }
 
+/*
+ * set_fsecs_reps - Time each function with exactly "reps" runs instead
+ *     of the timing method's default (or adaptive) number. Must be
+ *     called before init_fsecs.
+ */
+void set_fsecs_reps(int reps_arg)
+{
+    reps = reps_arg;
+}
+
 /*
  * fsecs - Return the running time of a function f (in seconds)
  */
 double fsecs(fsecs_test_funct f, void *argp) 
 {
+    return fsecs_ci(f, argp, NULL, NULL);
+}
+
+/*
+ * fsecs_ci - Return the running time of a function f (in seconds), and
+ *     if lo and hi are not NULL, a 95% confidence interval for it. Timing
+ *     methods that do not estimate their error return an empty interval.
+ */
+double fsecs_ci(fsecs_test_funct f, void *argp, double *lo, double *hi)
+{
+    double secs;
+
 #if USE_FCYC
     double cycles = fcyc(f, argp);
-    return cycles/(Mhz*1e6);
+    secs = cycles/(Mhz*1e6);
 #elif USE_ITIMER
-    return ftimer_itimer(f, argp, 10);
+    secs = ftimer_itimer(f, argp, reps ? reps : 10);
 #elif USE_GETTOD
-    return ftimer_gettod(f, argp, 10);
+    secs = ftimer_gettod(f, argp, reps ? reps : 10);
+#elif USE_CLOCK
+    secs = ftimer_clock(f, argp, lo, hi);
 #endif 
+#if !USE_CLOCK
+    /* The other methods do not estimate their error */
+    if (lo != NULL)
+	*lo = secs;
+    if (hi != NULL)
+	*hi = secs;
+#endif
+    return secs;
 }
 
 
@@ -1,4 +1,6 @@
 typedef void (*fsecs_test_funct)(void *);
 
 void init_fsecs(void);
+void set_fsecs_reps(int reps);
 double fsecs(fsecs_test_funct f, void *argp);
+double fsecs_ci(fsecs_test_funct f, void *argp, double *lo, double *hi);
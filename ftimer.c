@@ -7,11 +7,29 @@
  * Function timers that estimate the running time (in seconds) of a function f.
  *    ftimer_itimer: version that uses the interval timer
  *    ftimer_gettod: version that uses gettimeofday
+ *    ftimer_clock: version that uses clock_gettime and repeats until the
+ *        median running time is known to within a target precision
  */
+#include <math.h>
 #include <stdio.h>
 #include <sys/time.h>
+#include <time.h>
 #include "ftimer.h"
 
+/* Default values for ftimer_clock */
+#define CLK_MINSAMPLES 11    /* Always take at least this many samples */
+#define CLK_MAXSAMPLES 301   /* Give up after this many samples */
+#define CLK_EPSILON 0.01     /* Target CI half-width, relative to median */
+#define CLK_MINTIME 1e-3     /* Minimum duration of one sample (secs) */
+#define CLK_BUDGET 2.0       /* Give up after this many secs of sampling */
+#define CLK_Z 1.96           /* Normal quantile for a 95% interval */
+
+#ifdef CLOCK_MONOTONIC_RAW
+#define CLK_ID CLOCK_MONOTONIC_RAW
+#else
+#define CLK_ID CLOCK_MONOTONIC
+#endif
+
 /* function prototypes */
 static void init_etime(void);
 static double get_etime(void);
@@ -53,6 +71,101 @@ double ftimer_gettod(ftimer_test_funct f, void *argp, int n)
 }
 
 
+/* If nonzero, the fixed number of samples ftimer_clock takes */
+static int clk_samples = 0;
+
+/*
+ * set_ftimer_clock_samples - Take exactly n single-run samples in
+ *     ftimer_clock (at most CLK_MAXSAMPLES), or sample adaptively if n
+ *     is 0
+ */
+void set_ftimer_clock_samples(int n)
+{
+    clk_samples = (n < CLK_MAXSAMPLES) ? n : CLK_MAXSAMPLES;
+}
+
+/*
+ * clk_secs - Read the monotonic clock, in seconds
+ */
+static double clk_secs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLK_ID, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+/*
+ * ftimer_clock - Use clock_gettime to estimate the running time of
+ * f(argp). Runs of f are batched so that one sample lasts at least
+ * CLK_MINTIME, then samples are taken until the distribution-free 95%
+ * confidence interval of their median is within CLK_EPSILON of the
+ * median (or the sample or time budget runs out). Return the median
+ * and, if lo and hi are not NULL, the bounds of its interval.
+ */
+double ftimer_clock(ftimer_test_funct f, void *argp, double *lo, double *hi)
+{
+    static double samples[CLK_MAXSAMPLES]; /* kept in ascending order */
+    double start, t, med, half;
+    int reps, n, i, pos, jlo, jhi;
+
+    /* Find a batch size long enough to time accurately */
+    reps = 1;
+    while (clk_samples == 0) {
+	t = clk_secs();
+	for (i = 0; i < reps; i++)
+	    f(argp);
+	t = clk_secs() - t;
+	if (t >= CLK_MINTIME)
+	    break;
+	reps *= 2;
+    }
+
+    start = clk_secs();
+    n = 0;
+    for (;;) {
+	t = clk_secs();
+	for (i = 0; i < reps; i++)
+	    f(argp);
+	t = (clk_secs() - t) / reps;
+
+	/* Insertion sort */
+	pos = n++;
+	while (pos > 0 && samples[pos-1] > t) {
+	    samples[pos] = samples[pos-1];
+	    pos--;
+	}
+	samples[pos] = t;
+
+	/* Order statistics bounding the median with 95% confidence */
+	half = CLK_Z * sqrt((double)n) / 2;
+	jlo = (int)floor(n / 2.0 - half);
+	jhi = (int)ceil(n / 2.0 + half);
+	if (jlo < 0)
+	    jlo = 0;
+	if (jhi > n - 1)
+	    jhi = n - 1;
+	med = (n % 2) ? samples[n/2] : (samples[n/2 - 1] + samples[n/2]) / 2;
+
+	if (clk_samples > 0) {
+	    if (n == clk_samples)
+		break;
+	    continue;
+	}
+	if (n >= CLK_MINSAMPLES &&
+	    samples[jhi] - samples[jlo] <= 2 * CLK_EPSILON * med)
+	    break;
+	if (n == CLK_MAXSAMPLES || clk_secs() - start > CLK_BUDGET)
+	    break;
+    }
+
+    if (lo != NULL)
+	*lo = samples[jlo];
+    if (hi != NULL)
+	*hi = samples[jhi];
+    return med;
+}
+
 /*
  * Routines for manipulating the Unix interval timer
  */
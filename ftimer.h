@@ -12,3 +12,11 @@ double ftimer_itimer(ftimer_test_funct f, void *argp, int n);
    Return the average of n runs */
 double ftimer_gettod(ftimer_test_funct f, void *argp, int n);
 
+/* Estimate the running time of f(argp) using clock_gettime. Repeat
+   until the median is known to within 1%, and return the median along
+   with the bounds of its 95% confidence interval in *lo and *hi */
+double ftimer_clock(ftimer_test_funct f, void *argp, double *lo, double *hi);
+
+/* Make ftimer_clock take exactly n samples of one run each, or restore
+   the adaptive scheme if n is 0 */
+void set_ftimer_clock_samples(int n);
@@ -0,0 +1,565 @@
+/*
+ * heapviz.c - Inspect the event logs that mm.c writes when it is built
+ *             with MM_EVLOG ("make EVLOG=1; mdriver -E <prefix>")
+ *
+ * Commands:
+ *
+ *   heapviz dump <log> [from=N] [to=N]
+ *	Print the events, one per line.
+ *   heapviz layout <log> [op=N]
+ *	Rebuild the heap as it was after op N (default: the last op) and
+ *	list its blocks.
+ *   heapviz map <log> [op=N] [width=N] [rows=N]
+ *	Render the heap after op N as a grid of characters, each standing
+ *	for an equal share of the heap, to show where free space is.
+ *   heapviz diff <log1> <log2> [show=N] [addrs=0]
+ *	Compare the decisions that two versions of the allocator made on
+ *	the same trace, op by op. Once one version places a block
+ *	elsewhere, every later address differs; addrs=0 compares only the
+ *	kinds and sizes of the decisions.
+ *
+ * Every command takes run=N to pick a run, i.e., the events from the
+ * Nth mm_init on (default 0).
+ *
+ * The layout is rebuilt from the events alone. MM_EV_ALLOC, MM_EV_INSERT
+ * and MM_EV_COALESCE each give the extent of a block, which replaces
+ * whatever blocks were there before. Since the blocks tile the heap,
+ * walking from the first block by block sizes skips any stale starts
+ * left inside a block. Only the first region of the heap is rebuilt;
+ * the events of blocks in the large-block region that mm_set_regions
+ * adds lie beyond its end and are passed over.
+ */
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mm.h"
+
+#define GRAIN 8                 /* block addresses are multiples of this */
+
+/* The events of one run of the allocator */
+typedef struct {
+    char *file;
+    mm_event_t *ev;
+    size_t n;
+    uint32_t last_op;           /* the op of the last event */
+} evlog_t;
+
+/* The heap rebuilt from a run's events, indexed by address / GRAIN */
+typedef struct {
+    uint64_t first;             /* address of the first block */
+    uint64_t end;               /* address of the epilogue */
+    uint64_t cap;               /* entries in size, alloc and cls */
+    uint64_t *size;             /* size of the block starting here */
+    unsigned char *alloc;       /* is that block allocated? */
+    unsigned char *cls;         /* its size class */
+} layout_t;
+
+static const char *type_names[MM_EV_NTYPES] = {
+    "init", "malloc", "free", "realloc", "memalign", "extend", "alloc",
+    "release", "insert", "remove", "split", "coalesce", "resize"
+};
+static const char *split_names[] = {"front", "back", "align"};
+static const char *coalesce_names[] = {"none", "next", "prev", "both"};
+static const char *resize_names[] = {"inplace", "next", "prev", "both",
+				     "move"};
+
+/* Options, set by the key=value arguments */
+static int run = 0;
+static uint32_t op_limit = UINT32_MAX;
+static uint32_t from = 0, to = UINT32_MAX;
+static int width = 64, rows = 16;
+static int show = 5;
+static int addrs = 1;           /* does diff compare addresses? */
+
+static void usage(void);
+static void viz_error(char *msg, char *arg);
+
+/*
+ * read_log - Read the events of run "run" from an event log file
+ */
+static void read_log(char *file, evlog_t *log)
+{
+    char magic[8];
+    uint32_t header[2];
+    mm_event_t e;
+    size_t cap = 0;
+    int r = -1;
+    FILE *fp;
+
+    if ((fp = fopen(file, "rb")) == NULL)
+	viz_error(strerror(errno), file);
+    if (fread(magic, 1, 8, fp) != 8 ||
+	memcmp(magic, MM_EVLOG_MAGIC, 8) != 0)
+	viz_error("not an event log", file);
+    if (fread(header, sizeof(header), 1, fp) != 1 ||
+	header[0] != sizeof(mm_event_t))
+	viz_error("event log from an incompatible mm.h", file);
+
+    log->file = file;
+    log->ev = NULL;
+    log->n = 0;
+    log->last_op = 0;
+    while (fread(&e, sizeof(e), 1, fp) == 1) {
+	if (e.type == MM_EV_INIT)
+	    r++;
+	if (r < run)
+	    continue;
+	if (r > run)
+	    break;
+	if (log->n == cap) {
+	    cap = cap ? 2 * cap : 4096;
+	    if ((log->ev = realloc(log->ev, cap * sizeof(e))) == NULL)
+		viz_error("out of memory", NULL);
+	}
+	log->ev[log->n++] = e;
+	log->last_op = e.op;
+    }
+    fclose(fp);
+    if (log->n == 0)
+	viz_error("no such run in event log", file);
+}
+
+/*
+ * event_name - The name of an event type, with its aux where it has a
+ *     name of its own
+ */
+static const char *event_name(const mm_event_t *e, char *buf, size_t len)
+{
+    const char *type = e->type < MM_EV_NTYPES ? type_names[e->type] : "?";
+    const char *aux = NULL;
+
+    if (e->type == MM_EV_SPLIT && e->aux <= MM_SPLIT_ALIGN)
+	aux = split_names[e->aux];
+    else if (e->type == MM_EV_COALESCE && e->aux <= MM_COALESCE_BOTH)
+	aux = coalesce_names[e->aux];
+    else if (e->type == MM_EV_RESIZE && e->aux <= MM_RESIZE_MOVE)
+	aux = resize_names[e->aux];
+    if (aux == NULL)
+	return type;
+    snprintf(buf, len, "%s:%s", type, aux);
+    return buf;
+}
+
+/*
+ * print_event - Print one event on a line
+ */
+static void print_event(const mm_event_t *e)
+{
+    char buf[32];
+
+    printf("%8u %-16s", e->op, event_name(e, buf, sizeof(buf)));
+    switch (e->type) {
+    case MM_EV_MALLOC:
+    case MM_EV_MEMALIGN:
+	printf(" size %llu", (unsigned long long)e->size);
+	if (e->type == MM_EV_MEMALIGN)
+	    printf(" align %u", 1u << e->aux);
+	break;
+    case MM_EV_REALLOC:
+	printf(" @%-10llu size %llu", (unsigned long long)e->addr,
+	       (unsigned long long)e->size);
+	break;
+    default:
+	printf(" @%-10llu %8llu bytes", (unsigned long long)e->addr,
+	       (unsigned long long)e->size);
+	if (e->type >= MM_EV_ALLOC)
+	    printf("  class %d", e->cls);
+	break;
+    }
+    printf("\n");
+}
+
+/*
+ * set_block - Record the block that event e describes in the layout
+ */
+static void set_block(layout_t *l, mm_event_t *e, int alloc)
+{
+    uint64_t addr = e->addr;
+    uint64_t i = addr / GRAIN;
+
+    if (i >= l->cap) {
+	uint64_t cap = l->cap ? l->cap : 1024;
+
+	while (cap <= i)
+	    cap *= 2;
+	if ((l->size = realloc(l->size, cap * sizeof(uint64_t))) == NULL ||
+	    (l->alloc = realloc(l->alloc, cap)) == NULL ||
+	    (l->cls = realloc(l->cls, cap)) == NULL)
+	    viz_error("out of memory", NULL);
+	memset(l->size + l->cap, 0, (cap - l->cap) * sizeof(uint64_t));
+	memset(l->alloc + l->cap, 0, cap - l->cap);
+	memset(l->cls + l->cap, 0, cap - l->cap);
+	l->cap = cap;
+    }
+    l->size[i] = e->size;
+    l->alloc[i] = alloc;
+    l->cls[i] = e->cls;
+}
+
+/*
+ * build_layout - Rebuild the heap as it was after op "op"
+ */
+static void build_layout(evlog_t *log, uint32_t op, layout_t *l)
+{
+    size_t k;
+
+    memset(l, 0, sizeof(*l));
+    for (k = 0; k < log->n && log->ev[k].op <= op; k++) {
+	mm_event_t *e = &log->ev[k];
+
+	/* Skip the events of other regions */
+	if (e->type == MM_EV_EXTEND ? (l->first != 0 && e->addr != l->end) :
+	    e->addr >= l->end)
+	    continue;
+	switch (e->type) {
+	case MM_EV_EXTEND:
+	    /* The new free block takes over the old epilogue's word */
+	    if (l->first == 0)
+		l->first = e->addr;
+	    l->end = e->addr + e->size;
+	    set_block(l, e, 0);
+	    break;
+	case MM_EV_ALLOC:
+	    set_block(l, e, 1);
+	    break;
+	case MM_EV_RELEASE:
+	case MM_EV_INSERT:
+	case MM_EV_COALESCE:
+	    set_block(l, e, 0);
+	    break;
+	}
+    }
+}
+
+/*
+ * next_block - Step from the block at "addr" to the next one. Returns 0
+ *     at the end of the heap or if the layout is inconsistent.
+ */
+static int next_block(layout_t *l, uint64_t *addr)
+{
+    uint64_t size = l->size[*addr / GRAIN];
+
+    if (size == 0 || *addr + size > l->end) {
+	if (*addr != l->end)
+	    fprintf(stderr, "heapviz: layout breaks off at %llu\n",
+		    (unsigned long long)*addr);
+	return 0;
+    }
+    *addr += size;
+    return *addr < l->end;
+}
+
+/*
+ * summarize - Print the totals of a layout
+ */
+static void summarize(layout_t *l, uint32_t op)
+{
+    uint64_t addr = l->first, used = 0, unused = 0, largest = 0;
+    unsigned long nalloc = 0, nfree = 0;
+
+    if (l->end > l->first) {
+	do {
+	    uint64_t size = l->size[addr / GRAIN];
+
+	    if (l->alloc[addr / GRAIN]) {
+		used += size;
+		nalloc++;
+	    } else {
+		unused += size;
+		nfree++;
+		if (size > largest)
+		    largest = size;
+	    }
+	} while (next_block(l, &addr));
+    }
+    printf("After op %u: heap %llu bytes, %lu allocated blocks (%llu bytes), "
+	   "%lu free blocks (%llu bytes)\n", op, (unsigned long long)l->end,
+	   nalloc, (unsigned long long)used, nfree, (unsigned long long)unused);
+    printf("Largest free block %llu bytes, external fragmentation %.1f%%\n",
+	   (unsigned long long)largest,
+	   unused ? 100.0 * (1.0 - (double)largest / unused) : 0.0);
+}
+
+/*
+ * do_dump - Print the events of ops "from" through "to"
+ */
+static void do_dump(evlog_t *log)
+{
+    size_t k;
+
+    for (k = 0; k < log->n; k++)
+	if (log->ev[k].op >= from && log->ev[k].op <= to)
+	    print_event(&log->ev[k]);
+}
+
+/*
+ * do_layout - List the blocks of the heap after op "op_limit"
+ */
+static void do_layout(evlog_t *log)
+{
+    uint32_t op = op_limit < log->last_op ? op_limit : log->last_op;
+    uint64_t addr;
+    layout_t l;
+
+    build_layout(log, op, &l);
+    printf("%12s %10s %6s %5s\n", "addr", "size", "state", "class");
+    if ((addr = l.first) < l.end) {
+	do {
+	    uint64_t size = l.size[addr / GRAIN];
+
+	    printf("%12llu %10llu %6s", (unsigned long long)addr,
+		   (unsigned long long)size, l.alloc[addr / GRAIN] ?
+		   "alloc" : "free");
+	    if (!l.alloc[addr / GRAIN])
+		printf(" %5d", l.cls[addr / GRAIN]);
+	    printf("\n");
+	} while (next_block(&l, &addr));
+    }
+    summarize(&l, op);
+}
+
+/*
+ * do_map - Draw the heap after op "op_limit" as "rows" lines of "width"
+ *     cells. A cell is '#' if it is all allocated, '.' if it is all free,
+ *     and '+' or '-' if it is mostly allocated or mostly free.
+ */
+static void do_map(evlog_t *log)
+{
+    uint32_t op = op_limit < log->last_op ? op_limit : log->last_op;
+    uint64_t addr, span, cell, lo, hi;
+    double *used;
+    int ncells = width * rows, c;
+    layout_t l;
+
+    build_layout(log, op, &l);
+    if (l.end <= l.first)
+	viz_error("the heap is empty at that op", NULL);
+    span = l.end - l.first;
+    cell = (span + ncells - 1) / ncells;
+    if ((used = calloc(ncells, sizeof(double))) == NULL)
+	viz_error("out of memory", NULL);
+
+    /* Spread each allocated block over the cells it overlaps */
+    addr = l.first;
+    do {
+	uint64_t start = addr - l.first;
+	uint64_t end = start + l.size[addr / GRAIN];
+
+	if (!l.alloc[addr / GRAIN])
+	    continue;
+	for (c = start / cell; c < ncells && (uint64_t)c * cell < end; c++) {
+	    lo = (uint64_t)c * cell;
+	    hi = lo + cell;
+	    used[c] += (double)((end < hi ? end : hi) -
+				(start > lo ? start : lo));
+	}
+    } while (next_block(&l, &addr));
+
+    printf("Heap after op %u, %llu bytes per cell:\n", op,
+	   (unsigned long long)cell);
+    for (c = 0; c < ncells && (uint64_t)c * cell < span; c++) {
+	double frac = used[c] / cell;
+
+	putchar(frac >= 1.0 ? '#' : frac >= 0.5 ? '+' :
+		frac > 0.0 ? '-' : '.');
+	if ((c + 1) % width == 0)
+	    putchar('\n');
+    }
+    if (c % width != 0)
+	putchar('\n');
+    summarize(&l, op);
+    free(used);
+}
+
+/*
+ * same_event - Did the two allocators make the same decision?
+ */
+static int same_event(const mm_event_t *a, const mm_event_t *b)
+{
+    return a->type == b->type && a->aux == b->aux && a->size == b->size &&
+	(!addrs || a->addr == b->addr);
+}
+
+/*
+ * op_end - The index of the first event after those of op ev[k].op
+ */
+static size_t op_end(evlog_t *log, size_t k)
+{
+    uint32_t op = log->ev[k].op;
+
+    while (k < log->n && log->ev[k].op == op)
+	k++;
+    return k;
+}
+
+/*
+ * do_diff - Compare two logs of the same trace op by op, then count the
+ *     decisions of each kind that each allocator made
+ */
+static void do_diff(evlog_t *a, evlog_t *b)
+{
+    unsigned long count[2][MM_EV_NTYPES][8];
+    size_t ka = 0, kb = 0, ea, eb, i;
+    unsigned long ops = 0, differ = 0;
+    evlog_t *logs[2] = {a, b};
+    char buf[32];
+    int t, x, s;
+
+    /* Walk the two logs in step, one op at a time */
+    while (ka < a->n && kb < b->n) {
+	if (a->ev[ka].op != b->ev[kb].op) {
+	    printf("The logs are of different traces (op %u vs. op %u)\n",
+		   a->ev[ka].op, b->ev[kb].op);
+	    break;
+	}
+	ea = op_end(a, ka);
+	eb = op_end(b, kb);
+	ops++;
+	for (i = 0; ka + i < ea && kb + i < eb; i++)
+	    if (!same_event(&a->ev[ka + i], &b->ev[kb + i]))
+		break;
+	if (ka + i < ea || kb + i < eb) {
+	    if (differ++ < (unsigned long)show) {
+		printf("Op %u differs:\n  %s:\n", a->ev[ka].op, a->file);
+		for (i = ka; i < ea; i++)
+		    print_event(&a->ev[i]);
+		printf("  %s:\n", b->file);
+		for (i = kb; i < eb; i++)
+		    print_event(&b->ev[i]);
+	    }
+	}
+	ka = ea;
+	kb = eb;
+    }
+    printf("%lu of %lu ops differ\n\n", differ, ops);
+
+    /* Count the decisions by type and aux */
+    memset(count, 0, sizeof(count));
+    for (s = 0; s < 2; s++)
+	for (i = 0; i < logs[s]->n; i++) {
+	    mm_event_t *e = &logs[s]->ev[i];
+
+	    if (e->type < MM_EV_NTYPES)
+		count[s][e->type][e->aux < 8 ? e->aux : 7]++;
+	}
+    printf("%-16s %12s %12s\n", "event", "log 1", "log 2");
+    for (t = MM_EV_EXTEND; t < MM_EV_NTYPES; t++) {
+	int split = (t == MM_EV_SPLIT || t == MM_EV_COALESCE ||
+		     t == MM_EV_RESIZE);
+
+	for (x = 0; x < (split ? 8 : 1); x++) {
+	    mm_event_t e = {0, t, 0, x, 0, 0};
+	    unsigned long n0 = 0, n1 = 0;
+	    int y;
+
+	    if (split) {
+		n0 = count[0][t][x];
+		n1 = count[1][t][x];
+	    } else {
+		for (y = 0; y < 8; y++) {
+		    n0 += count[0][t][y];
+		    n1 += count[1][t][y];
+		}
+	    }
+	    if (split && n0 == 0 && n1 == 0)
+		continue;
+	    printf("%-16s %12lu %12lu\n", event_name(&e, buf, sizeof(buf)),
+		   n0, n1);
+	}
+    }
+}
+
+int main(int argc, char **argv)
+{
+    char *cmd, *key, *val, *files[2];
+    int i, nfiles = 0;
+    evlog_t logs[2];
+
+    if (argc < 2 || strcmp(argv[1], "-h") == 0) {
+	usage();
+	exit(argc < 2);
+    }
+    cmd = argv[1];
+    for (i = 2; i < argc; i++) {
+	key = argv[i];
+	if ((val = strchr(key, '=')) == NULL) {
+	    if (nfiles == 2)
+		viz_error("too many files", key);
+	    files[nfiles++] = key;
+	    continue;
+	}
+	*val++ = '\0';
+	if (strcmp(key, "run") == 0)
+	    run = atoi(val);
+	else if (strcmp(key, "op") == 0)
+	    op_limit = strtoul(val, NULL, 0);
+	else if (strcmp(key, "from") == 0)
+	    from = strtoul(val, NULL, 0);
+	else if (strcmp(key, "to") == 0)
+	    to = strtoul(val, NULL, 0);
+	else if (strcmp(key, "width") == 0)
+	    width = atoi(val);
+	else if (strcmp(key, "rows") == 0)
+	    rows = atoi(val);
+	else if (strcmp(key, "show") == 0)
+	    show = atoi(val);
+	else if (strcmp(key, "addrs") == 0)
+	    addrs = atoi(val);
+	else
+	    viz_error("unknown key", key);
+    }
+    if (width <= 0 || rows <= 0)
+	viz_error("width and rows must be positive", NULL);
+    if (nfiles != (strcmp(cmd, "diff") == 0 ? 2 : 1))
+	viz_error("wrong number of event logs for", cmd);
+    for (i = 0; i < nfiles; i++)
+	read_log(files[i], &logs[i]);
+
+    if (strcmp(cmd, "dump") == 0)
+	do_dump(&logs[0]);
+    else if (strcmp(cmd, "layout") == 0)
+	do_layout(&logs[0]);
+    else if (strcmp(cmd, "map") == 0)
+	do_map(&logs[0]);
+    else if (strcmp(cmd, "diff") == 0)
+	do_diff(&logs[0], &logs[1]);
+    else
+	viz_error("unknown command", cmd);
+    return 0;
+}
+
+/*
+ * viz_error - Report an error and exit
+ */
+static void viz_error(char *msg, char *arg)
+{
+    if (arg != NULL)
+	fprintf(stderr, "heapviz: %s: %s\n", msg, arg);
+    else
+	fprintf(stderr, "heapviz: %s\n", msg);
+    exit(1);
+}
+
+/*
+ * usage - Explain the commands
+ */
+static void usage(void)
+{
+    fprintf(stderr, "Usage: heapviz <command> <log> [<log>] "
+	    "[key=value ...]\n");
+    fprintf(stderr, "Commands:\n");
+    fprintf(stderr, "\tdump <log>          Print the events "
+	    "(from=<n>, to=<n>: ops).\n");
+    fprintf(stderr, "\tlayout <log>        List the blocks after op=<n> "
+	    "(default last).\n");
+    fprintf(stderr, "\tmap <log>           Draw the heap after op=<n> "
+	    "(width=64, rows=16).\n");
+    fprintf(stderr, "\tdiff <log1> <log2>  Compare two allocators' "
+	    "decisions (show=5 ops,\n"
+	    "\t                    addrs=0 to ignore addresses).\n");
+    fprintf(stderr, "\trun=<n>             Use the events of the <n>th "
+	    "mm_init (default 0).\n");
+}
@@ -0,0 +1,150 @@
+/*
+ * lathist.c - Log-bucketed latency histograms for per-operation timing
+ *
+ * Samples are tick counts from lat_now(). A value v >= 4 falls into the
+ * bucket for its power of two, refined by the next LAT_SUBBITS bits, so
+ * recording a sample is a count-leading-zeros and an increment.
+ */
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include "lathist.h"
+
+/* Upper request size (bytes) of each size class but the last */
+static const size_t size_limits[LAT_NSIZES - 1] = {64, 512, 4096, 32768};
+
+static const char *size_labels[LAT_NSIZES] = {
+    "<=64", "<=512", "<=4K", "<=32K", ">32K"
+};
+
+/*
+ * bucket_of - Map a tick count to its histogram bucket
+ */
+static int bucket_of(uint64_t v)
+{
+    int e;
+
+    if (v < (1 << LAT_SUBBITS))
+	return (int)v;
+    e = 63 - __builtin_clzll(v);
+    return ((e - LAT_SUBBITS + 1) << LAT_SUBBITS) +
+	(int)((v >> (e - LAT_SUBBITS)) & ((1 << LAT_SUBBITS) - 1));
+}
+
+/*
+ * bucket_max - Return the largest tick count that maps to bucket b
+ */
+static uint64_t bucket_max(int b)
+{
+    int e;
+    uint64_t lo;
+
+    if (b < (2 << LAT_SUBBITS))
+	return (uint64_t)b;
+    e = (b >> LAT_SUBBITS) + LAT_SUBBITS - 1;
+    lo = ((uint64_t)((1 << LAT_SUBBITS) + (b & ((1 << LAT_SUBBITS) - 1))))
+	<< (e - LAT_SUBBITS);
+    return lo + ((uint64_t)1 << (e - LAT_SUBBITS)) - 1;
+}
+
+/*
+ * lat_init - Reset all of the histograms in lat
+ */
+void lat_init(lat_t *lat)
+{
+    memset(lat, 0, sizeof(lat_t));
+}
+
+/*
+ * lat_record - Record one sample for an op of the given type and size
+ */
+void lat_record(lat_t *lat, int op, size_t size, uint64_t ticks)
+{
+    int sc = 0;
+    lat_hist_t *h;
+
+    while (sc < LAT_NSIZES - 1 && size > size_limits[sc])
+	sc++;
+    h = &lat->hist[op][sc];
+    h->count++;
+    h->buckets[bucket_of(ticks)]++;
+    if (ticks > h->max)
+	h->max = ticks;
+}
+
+/*
+ * lat_merge - Combine all size classes of one op type into "out"
+ */
+void lat_merge(const lat_t *lat, int op, lat_hist_t *out)
+{
+    int sc, b;
+
+    memset(out, 0, sizeof(lat_hist_t));
+    for (sc = 0; sc < LAT_NSIZES; sc++) {
+	const lat_hist_t *h = &lat->hist[op][sc];
+
+	out->count += h->count;
+	if (h->max > out->max)
+	    out->max = h->max;
+	for (b = 0; b < LAT_NBUCKETS; b++)
+	    out->buckets[b] += h->buckets[b];
+    }
+}
+
+/*
+ * lat_percentile - Return the p-th percentile of h, as the upper bound
+ *     of the bucket that holds it (clipped to the largest sample)
+ */
+uint64_t lat_percentile(const lat_hist_t *h, double p)
+{
+    uint64_t rank, seen = 0;
+    int b;
+
+    if (h->count == 0)
+	return 0;
+    /* The nearest rank: the smallest that covers p% of the samples */
+    rank = (uint64_t)ceil(p * h->count / 100.0);
+    if (rank < 1)
+	rank = 1;
+    if (rank > h->count)
+	rank = h->count;
+    for (b = 0; b < LAT_NBUCKETS; b++) {
+	seen += h->buckets[b];
+	if (seen >= rank)
+	    return (bucket_max(b) < h->max) ? bucket_max(b) : h->max;
+    }
+    return h->max;
+}
+
+/*
+ * lat_ticks_per_ns - Calibrate lat_now() against CLOCK_MONOTONIC over
+ *     a 10 ms interval. The result is cached after the first call.
+ */
+double lat_ticks_per_ns(void)
+{
+    static double rate = 0.0;
+    struct timespec ts0, ts1;
+    uint64_t t0, t1;
+    double ns;
+
+    if (rate > 0.0)
+	return rate;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts0);
+    t0 = lat_now();
+    do {
+	clock_gettime(CLOCK_MONOTONIC, &ts1);
+	ns = 1e9 * (ts1.tv_sec - ts0.tv_sec) + (ts1.tv_nsec - ts0.tv_nsec);
+    } while (ns < 1e7);
+    t1 = lat_now();
+    rate = (double)(t1 - t0) / ns;
+    return rate;
+}
+
+/*
+ * lat_size_label - Return a printable label for size class sc
+ */
+const char *lat_size_label(int sc)
+{
+    return size_labels[sc];
+}
@@ -0,0 +1,70 @@
+/*
+ * lathist.h - Log-bucketed latency histograms for per-operation timing
+ *
+ * Each histogram bucket covers a quarter of a power of two, so the
+ * reported percentiles are within 25% of the true value while a full
+ * 64-bit range of tick counts fits in LAT_NBUCKETS counters.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#define LAT_SUBBITS  2                       /* log2(sub-buckets per power) */
+#define LAT_NBUCKETS (64 << LAT_SUBBITS)     /* buckets per histogram */
+
+/* Operation types, in the same order as the trace's request types */
+#define LAT_MALLOC   0
+#define LAT_FREE     1
+#define LAT_REALLOC  2
+#define LAT_NOPS     3
+
+/* Request size classes: <=64, <=512, <=4K, <=32K, and larger */
+#define LAT_NSIZES   5
+
+/* A single latency distribution, in counter ticks */
+typedef struct {
+    uint64_t count;                  /* number of samples */
+    uint64_t max;                    /* largest sample seen */
+    uint64_t buckets[LAT_NBUCKETS];  /* sample counts per bucket */
+} lat_hist_t;
+
+/* Latency distributions for one trace, per op type and size class */
+typedef struct {
+    lat_hist_t hist[LAT_NOPS][LAT_NSIZES];
+} lat_t;
+
+/*
+ * lat_now - Read a low-overhead, monotonically increasing tick counter
+ */
+static inline uint64_t lat_now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+    uint64_t val;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r" (val));
+    return val;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+/* Reset all of the histograms in lat */
+void lat_init(lat_t *lat);
+
+/* Record a sample of "ticks" for an op of type "op" on "size" bytes */
+void lat_record(lat_t *lat, int op, size_t size, uint64_t ticks);
+
+/* Merge the size classes of op "op" into the single histogram "out" */
+void lat_merge(const lat_t *lat, int op, lat_hist_t *out);
+
+/* Return the p-th percentile (0 < p <= 100) of h, in ticks */
+uint64_t lat_percentile(const lat_hist_t *h, double p);
+
+/* Return the number of lat_now() ticks per nanosecond */
+double lat_ticks_per_ns(void);
+
+/* Return a printable label for size class sc */
+const char *lat_size_label(int sc);
@@ -7,6 +7,7 @@
  * Copyright (c) 2002, R. Bryant and D. O'Hallaron, All rights reserved.
  * May not be used, modified, or copied without permission.
  */
+#define _GNU_SOURCE
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -16,10 +17,19 @@
 #include <assert.h>
 #include <float.h>
 #include <time.h>
+#include <math.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <poll.h>
 
 #include "mm.h"
 #include "memlib.h"
 #include "fsecs.h"
+#include "lathist.h"
+#include "perfctr.h"
 #include "config.h"
 
 /**********************
@@ -28,6 +38,9 @@
 
 /* Misc */
 #define MAXLINE     1024 /* max string size */
+#define MAXFIELDS     48 /* max number of metrics in one result record */
+#define CACHELINE     64 /* stride (bytes) for touching payloads */
+#define MAXBACKENDS   16 /* max number of allocators evaluated in one run */
 #define HDRLINES       4 /* number of header lines in a trace file */
 #define LINENUM(i) (i+5) /* cnvt trace request nums to linenums (origin 1) */
 
@@ -63,6 +76,25 @@ typedef struct {
     size_t *block_sizes; /* ... and a corresponding array of payload sizes */
 } trace_t;
 
+/* The allocator entry points replayed by the instrumented routines */
+typedef void *(*malloc_funct)(size_t);
+typedef void (*free_funct)(void *);
+typedef void *(*realloc_funct)(void *, size_t);
+
+/* 
+ * An allocator that the driver can evaluate. The mm package and libc
+ * malloc are built in; others are loaded from shared libraries (-B).
+ */
+typedef struct {
+    char *name;                /* package name used in the results */
+    int (*init)(void);         /* start over with an empty heap */
+    malloc_funct malloc_f;
+    free_funct free_f;
+    realloc_funct realloc_f;
+    size_t (*heapsize)(void);  /* heap size in bytes, or NULL if unknown */
+    void *handle;              /* dlopen handle, if loaded from a library */
+} backend_t;
+
 /* 
  * Holds the params to the xxx_speed functions, which are timed by fcyc. 
  * This struct is necessary because fcyc accepts only a pointer array
@@ -71,6 +103,10 @@ typedef struct {
 typedef struct {
     trace_t *trace;  
     range_t *ranges;
+    backend_t *backend;    /* allocator replayed by eval_backend_speed */
+    double touch;          /* fraction of each payload to touch (-T) */
+    uint64_t alloc_ticks;  /* ticks spent in the allocator by the... */
+    unsigned long runs;    /* ... this many runs of a touching replay */
 } speed_t;
 
 /* Summarizes the important stats for some malloc function on some trace */
@@ -79,13 +115,68 @@ typedef struct {
     double ops;      /* number of ops (malloc/free/realloc) in the trace */
     int valid;       /* was the trace processed correctly by the allocator? */
     double secs;     /* number of secs needed to run the trace */
+    double secs_lo;  /* 95% confidence interval for secs: lower bound... */
+    double secs_hi;  /* ... and upper bound */
 
     /* defined only for the student malloc package */
     double util;     /* space utilization for this trace (always 0 for libc) */
+    double heap;     /* heap size in bytes at the end of the trace */
+    double sbrks;    /* calls to mem_sbrk that grew the heap (mm only) */
+
+    /* defined only when per-op latencies are recorded (-H) */
+    lat_t *lat;      /* latency histograms per op type and size class */
+
+    /* defined only when hardware counters are read (-P) */
+    perf_counts_t *perf; /* event counts for one replay of the trace */
+
+    /* defined only when payloads are touched (-T) */
+    double touch_secs;       /* secs for a replay that touches payloads... */
+    double touch_alloc_secs; /* ... of which this many in the allocator */
+
+    /* defined only for steady-state runs of the mm package (-w) */
+    struct steady_t *steady; /* per-iteration results on a warm heap */
+
+    /* defined only when the mm package's heap is sampled over time (-u) */
+    struct timeline_t *timeline; /* heap samples every few ops */
+
+    /* defined only for an mm package built with probes, under -v */
+    mm_probes_t *probes; /* hot-path counts for one replay of the trace */
 
     /* Note: secs and util are only defined if valid is true */
 } stats_t; 
 
+/* Results of one iteration of a trace replayed on a warm heap */
+typedef struct {
+    double secs;     /* secs needed to run the trace */
+    double util;     /* peak live payload bytes over heap size */
+    double heap;     /* heap size in bytes at the end of the iteration */
+} iter_t;
+
+/* Results of replaying a trace repeatedly on the same heap */
+typedef struct steady_t {
+    int iters;       /* number of iterations completed... */
+    int exhausted;   /* ... before running out of heap, if set */
+    int warm;        /* number of blocks in the pre-fragmenting warm-up */
+    iter_t *iter;    /* the results of each iteration */
+} steady_t;
+
+/* The state of the mm package's heap after some op of a trace */
+typedef struct {
+    unsigned op;          /* number of ops completed */
+    double live;          /* live payload bytes */
+    double heap;          /* heap size in bytes */
+    double free;          /* bytes in free blocks... */
+    double largest;       /* ... and in the largest of them */
+    double class_free[MM_NCLASSES]; /* free bytes in each size class */
+} sample_t;
+
+/* Samples of the heap taken every "interval" ops of a trace */
+typedef struct timeline_t {
+    int n;                /* number of samples */
+    unsigned interval;    /* ops between samples */
+    sample_t *sample;     /* the samples, in op order */
+} timeline_t;
+
 /********************
  * Global variables
  *******************/
@@ -96,6 +187,18 @@ char msg[MAXLINE];      /* for whenever we need to compose an error message */
 /* Directory where default tracefiles are found */
 static char tracedir[MAXLINE] = TRACEDIR;
 
+/* Optional measurements, set by command line arguments */
+static int run_lat = 0;      /* If set, record per-op latencies (-H) */
+static int run_perf = 0;     /* If set, read hardware counters (-P) */
+static double touch = 0.0;   /* If set, fraction of payloads to touch (-T) */
+static int single_pass = 0;  /* If set, check validity and util together (-s) */
+static int sample = 1;       /* Check for overlaps every sample ops (-s) */
+static int steady_iters = 0; /* If set, replay on a warm heap this often (-w) */
+static int steady_warm = 1000; /* blocks allocated to age the heap (-W) */
+static unsigned timeline_interval = 0; /* If set, sample the heap (-u) */
+static char *evlog_prefix = NULL; /* If set, log mm's decisions here (-E) */
+static unsigned check_interval = 0; /* If set, check the mm heap (-c) */
+
 /* The filenames of the default tracefiles */
 static char *default_tracefiles[] = {  
     DEFAULT_TRACEFILES, NULL
@@ -112,27 +215,93 @@ static int add_range(range_t **ranges, char *lo, int size,
 static void remove_range(range_t **ranges, char *lo);
 static void clear_ranges(range_t **ranges);
 
+/* These functions check blocks without a range list */
+static int check_range(char *lo, int size, int tracenum, int opnum);
+static int check_overlaps(trace_t *trace, char *live, int tracenum,
+			  int opnum);
+
+/* These functions evaluate a package on each of the trace files */
+static void eval_backend_trace(char *tracefile, int i, stats_t *stats);
+static void eval_mm_trace(char *tracefile, int i, stats_t *stats);
+static void run_traces(char **tracefiles, int n, int workers,
+		       void (*eval_trace)(char *, int, stats_t *),
+		       stats_t *stats);
+
 /* These functions read, allocate, and free storage for traces */
 static trace_t *read_trace(char *tracedir, char *filename);
 static void free_trace(trace_t *trace);
 
-/* Routines for evaluating the correctness and speed of libc malloc */
-static int eval_libc_valid(trace_t *trace, int tracenum);
-static void eval_libc_speed(void *ptr);
+/* Routines for evaluating the correctness and speed of libc malloc, or
+   of an allocator loaded from a shared library */
+static int eval_backend_valid(trace_t *trace, int tracenum, backend_t *b,
+			      double *util);
+static void eval_backend_speed(void *ptr);
+static void load_backend(char *spec);
 
 /* Routines for evaluating correctnes, space utilization, and speed 
    of the student's malloc package in mm.c */
-static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges);
+static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges,
+			 int sample, double *util);
 static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges);
 static void eval_mm_speed(void *ptr);
+static void eval_mm_lat(trace_t *trace, lat_t *lat);
+static steady_t *eval_mm_steady(trace_t *trace, int iters, int warm);
+static int steady_iter(trace_t *trace, long pinned_size, iter_t *iter);
+static timeline_t *eval_mm_timeline(trace_t *trace, unsigned interval);
+static void eval_mm_evlog(speed_t *params, int tracenum);
+
+/* Replays a trace, timing each request individually */
+static void eval_lat(trace_t *trace, lat_t *lat, malloc_funct malloc_f,
+		     free_funct free_f, realloc_funct realloc_f);
+
+/* Replays a trace, writing and reading back part of each payload */
+static void eval_touch_speed(void *ptr);
+static void eval_touch(speed_t *params, malloc_funct malloc_f,
+		       free_funct free_f, realloc_funct realloc_f);
+static void eval_touch_timed(backend_t *b, speed_t *params,
+			     stats_t *stats);
+static int init_libc(void);
+static int init_mm(void);
+
+/* Reports the size classes, lifetimes and live set of a trace */
+static void analyze_trace(trace_t *trace, char *name);
+
+/* These functions export results and compare them against a baseline */
+static int result_fields(stats_t *stats, const char **names, double *vals);
+static void write_results(char *filename, char **tracefiles, int n,
+			  stats_t **stats, double perfindex);
+static int compare_baseline(char *filename, char **tracefiles, int n,
+			    stats_t *mm_stats);
+static void write_timeline(char *filename, char **tracefiles, int n,
+			   stats_t *mm_stats);
+static void csv_string(FILE *fp, const char *s);
+static void json_string(FILE *fp, const char *s);
 
 /* Various helper routines */
 static void printresults(int n, stats_t *stats);
+static void printlatency(int n, stats_t *stats);
+static void printperf(int n, stats_t *stats);
+static void printtouch(int n, stats_t *stats, double touch);
+static void printsteady(int n, stats_t *stats);
+static void printtimeline(int n, stats_t *stats);
+static void printprobes(int n, stats_t *stats);
+static void printgrowth(int n, stats_t *stats);
+static void printcompare(int n, stats_t **stats);
 static void usage(void);
 static void unix_error(char *msg);
 static void malloc_error(int tracenum, int opnum, char *msg);
 static void app_error(char *msg);
 
+/* 
+ * The allocators to evaluate: the mm package always comes first, then
+ * libc malloc (-l) and any loaded from shared libraries (-B)
+ */
+static backend_t backends[MAXBACKENDS] = {
+    {"mm", init_mm, mm_malloc, mm_free, mm_realloc, mem_heapsize, NULL}
+};
+static int num_backends = 1;
+static backend_t *cur_backend; /* the one eval_backend_trace evaluates */
+
 /**************
  * Main routine
  **************/
@@ -142,15 +311,22 @@ int main(int argc, char **argv)
     char c;
     char **tracefiles = NULL;  /* null-terminated array of trace file names */
     int num_tracefiles = 0;    /* the number of traces in that array */
-    trace_t *trace = NULL;     /* stores a single trace file in memory */
-    range_t *ranges = NULL;    /* keeps track of block extents for one trace */
-    stats_t *libc_stats = NULL;/* libc stats for each trace */
+    stats_t *stats[MAXBACKENDS]; /* stats for each backend and trace */
     stats_t *mm_stats = NULL;  /* mm (i.e. student) stats for each trace */
-    speed_t speed_params;      /* input parameters to the xx_speed routines */ 
+    char *libfiles[MAXBACKENDS]; /* shared libraries to load (-B) */
+    int num_libfiles = 0;
+    int b;
 
     int team_check = 1;  /* If set, check team structure (reset by -a) */
     int run_libc = 0;    /* If set, run libc malloc (set by -l) */
     int autograder = 0;  /* If set, emit summary info for autograder (-g) */
+    int workers = 1;     /* Number of worker processes (set by -j) */
+    int analyze = 0;     /* If set, only analyze the traces (set by -A) */
+    char *outfile = NULL;     /* If set, write results to this file (-o) */
+    char *baselinefile = NULL;/* If set, compare against this file (-b) */
+    char *timelinefile = "timeline.csv"; /* heap samples go here (-U) */
+    mm_growth_t growth;       /* the mm heap growth policy (-G) */
+    int regressed = 0;        /* set if the run regressed from the baseline */
 
     /* temporaries used to compute the performance index */
     double secs, ops, util, avg_mm_util, avg_mm_throughput, p1, p2, perfindex;
@@ -159,7 +335,7 @@ int main(int argc, char **argv)
     /* 
      * Read and interpret the command line arguments 
      */
-    while ((c = getopt(argc, argv, "f:t:hvVgal")) != EOF) {
+    while ((c = getopt(argc, argv, "f:t:hvVgalAB:c:E:G:HK:L:PRo:b:T:s:r:w:W:j:u:U:")) != EOF) {
         switch (c) {
 	case 'g': /* Generate summary info for the autograder */
 	    autograder = 1;
@@ -185,6 +361,121 @@ int main(int argc, char **argv)
         case 'l': /* Run libc malloc */
             run_libc = 1;
             break;
+        case 'B': /* Load another allocator from a shared library */
+            if (num_libfiles == MAXBACKENDS - 2)
+                app_error("Too many -B options");
+            libfiles[num_libfiles++] = optarg;
+            break;
+        case 'A': /* Analyze the traces instead of running them */
+            analyze = 1;
+            break;
+        case 'H': /* Record per-op latency histograms */
+            run_lat = 1;
+            break;
+        case 'P': /* Read hardware performance counters */
+            run_perf = 1;
+            break;
+        case 'T': /* Touch a fraction of each payload */
+            touch = atof(optarg);
+            if (touch <= 0.0 || touch > 1.0) {
+                usage();
+                exit(1);
+            }
+            break;
+        case 's': /* Single pass validity/util check, sampled */
+            single_pass = 1;
+            sample = atoi(optarg);
+            if (sample < 1) {
+                usage();
+                exit(1);
+            }
+            break;
+        case 'r': /* Number of timed repetitions per trace */
+            if (atoi(optarg) < 1) {
+                usage();
+                exit(1);
+            }
+            set_fsecs_reps(atoi(optarg));
+            break;
+        case 'w': /* Replay each trace repeatedly on a warm heap */
+            steady_iters = atoi(optarg);
+            if (steady_iters < 1) {
+                usage();
+                exit(1);
+            }
+            break;
+        case 'W': /* Size of the warm-up that pre-fragments the heap */
+            steady_warm = atoi(optarg);
+            if (steady_warm < 0) {
+                usage();
+                exit(1);
+            }
+            break;
+        case 'j': /* Evaluate the traces in parallel */
+            workers = atoi(optarg);
+            if (workers < 1) {
+                usage();
+                exit(1);
+            }
+            break;
+        case 'u': /* Sample the mm package's heap every so many ops */
+            if (atoi(optarg) < 1) {
+                usage();
+                exit(1);
+            }
+            timeline_interval = atoi(optarg);
+            break;
+        case 'U': /* Write the heap samples to this file */
+            timelinefile = optarg;
+            break;
+        case 'c': /* Check the mm package's heap after every op */
+            if (atoi(optarg) < 1) {
+                usage();
+                exit(1);
+            }
+            check_interval = atoi(optarg);
+            break;
+        case 'E': /* Log the mm package's decisions to files */
+            evlog_prefix = optarg;
+            break;
+        case 'G': /* Set the mm package's heap growth policy */
+            if (sscanf(optarg, "%zu:%zu:%u:%u", &growth.min_chunk,
+                       &growth.max_chunk, &growth.heap_percent,
+                       &growth.window) != 4 ||
+                growth.min_chunk > MAX_HEAP) {
+                usage();
+                exit(1);
+            }
+            mm_set_growth_policy(&growth);
+            break;
+        case 'K': /* Look at up to k fits in mm's find_fit */
+            if (atoi(optarg) < 1) {
+                usage();
+                exit(1);
+            }
+            mm_set_fit_search(atoi(optarg));
+            break;
+        case 'L': /* Order the mm package's free lists */
+            if (strcmp(optarg, "fifo") == 0)
+                mm_set_list_policy(MM_LIST_FIFO);
+            else if (strcmp(optarg, "lifo") == 0)
+                mm_set_list_policy(MM_LIST_LIFO);
+            else if (strcmp(optarg, "addr") == 0)
+                mm_set_list_policy(MM_LIST_ADDRESS);
+            else {
+                usage();
+                exit(1);
+            }
+            break;
+        case 'R': /* Give large mm blocks a heap region of their own */
+            mm_set_regions(1);
+            break;
+        case 'o': /* Write machine-readable results to a file */
+            outfile = optarg;
+            break;
+        case 'b': /* Compare the results against a baseline file */
+            baselinefile = optarg;
+            break;
         case 'v': /* Print per-trace performance breakdown */
             verbose = 1;
             break;
@@ -236,41 +527,61 @@ int main(int argc, char **argv)
 	printf("Using default tracefiles in %s\n", tracedir);
     }
 
+    /* Optionally describe the traces, without running any allocator */
+    if (analyze) {
+	for (i = 0; i < num_tracefiles; i++) {
+	    trace_t *trace = read_trace(tracedir, tracefiles[i]);
+
+	    analyze_trace(trace, tracefiles[i]);
+	    free_trace(trace);
+	}
+	exit(0);
+    }
+
     /* Initialize the timing package */
     init_fsecs();
 
+    /* Open the hardware performance counters */
+    if (run_perf && perf_init(verbose > 1) == 0) {
+	printf("Hardware performance counters are unavailable; "
+	       "ignoring -P\n");
+	run_perf = 0;
+    }
+
+    /* The event log is only there if mm.c was built with it */
+    if (evlog_prefix != NULL && !mm_evlog_attach(-1))
+	app_error("-E needs mm.c built with its event log (make EVLOG=1)");
+
+    /* Set up the other allocators to compare against the mm package */
+    if (run_libc)
+	backends[num_backends++] = (backend_t){"libc", init_libc, malloc,
+					      free, realloc, NULL, NULL};
+    for (i = 0; i < num_libfiles; i++)
+	load_backend(libfiles[i]);
+
     /*
-     * Optionally run and evaluate the libc malloc package 
+     * Optionally run and evaluate libc malloc and the loaded allocators
      */
-    if (run_libc) {
+    for (b = 1; b < num_backends; b++) {
 	if (verbose > 1)
-	    printf("\nTesting libc malloc\n");
+	    printf("\nTesting %s malloc\n", backends[b].name);
 	
-	/* Allocate libc stats array, with one stats_t struct per tracefile */
-	libc_stats = (stats_t *)calloc(num_tracefiles, sizeof(stats_t));
-	if (libc_stats == NULL)
-	    unix_error("libc_stats calloc in main failed");
+	/* Allocate a stats array, with one stats_t struct per tracefile */
+	stats[b] = (stats_t *)calloc(num_tracefiles, sizeof(stats_t));
+	if (stats[b] == NULL)
+	    unix_error("stats calloc in main failed");
 	
-	/* Evaluate the libc malloc package using the K-best scheme */
-	for (i=0; i < num_tracefiles; i++) {
-	    trace = read_trace(tracedir, tracefiles[i]);
-	    libc_stats[i].ops = trace->num_ops;
-	    if (verbose > 1)
-		printf("Checking libc malloc for correctness, ");
-	    libc_stats[i].valid = eval_libc_valid(trace, i);
-	    if (libc_stats[i].valid) {
-		speed_params.trace = trace;
-		if (verbose > 1)
-		    printf("and performance.\n");
-		libc_stats[i].secs = fsecs(eval_libc_speed, &speed_params);
-	    }
-	    free_trace(trace);
-	}
+	/* Evaluate the package using the K-best scheme */
+	cur_backend = &backends[b];
+	run_traces(tracefiles, num_tracefiles, workers, eval_backend_trace,
+		   stats[b]);
 
-	/* Display the libc results in a compact table */
+	/* Display the results in a compact table */
 	if (verbose) {
-	    printf("\nResults for libc malloc:\n");
-	    printresults(num_tracefiles, libc_stats);
+	    printf("\nResults for %s malloc:\n", backends[b].name);
+	    printresults(num_tracefiles, stats[b]);
+	    if (touch > 0.0)
+		printtouch(num_tracefiles, stats[b], touch);
 	}
     }
 
@@ -285,33 +596,28 @@ int main(int argc, char **argv)
     if (mm_stats == NULL)
 	unix_error("mm_stats calloc in main failed");
     
-    /* Initialize the simulated memory system in memlib.c */
-    mem_init(); 
-
     /* Evaluate student's mm malloc package using the K-best scheme */
-    for (i=0; i < num_tracefiles; i++) {
-	trace = read_trace(tracedir, tracefiles[i]);
-	mm_stats[i].ops = trace->num_ops;
-	if (verbose > 1)
-	    printf("Checking mm_malloc for correctness, ");
-	mm_stats[i].valid = eval_mm_valid(trace, i, &ranges);
-	if (mm_stats[i].valid) {
-	    if (verbose > 1)
-		printf("efficiency, ");
-	    mm_stats[i].util = eval_mm_util(trace, i, &ranges);
-	    speed_params.trace = trace;
-	    speed_params.ranges = ranges;
-	    if (verbose > 1)
-		printf("and performance.\n");
-	    mm_stats[i].secs = fsecs(eval_mm_speed, &speed_params);
-	}
-	free_trace(trace);
-    }
+    run_traces(tracefiles, num_tracefiles, workers, eval_mm_trace, mm_stats);
+    stats[0] = mm_stats;
 
     /* Display the mm results in a compact table */
     if (verbose) {
 	printf("\nResults for mm malloc:\n");
 	printresults(num_tracefiles, mm_stats);
+	printgrowth(num_tracefiles, mm_stats);
+	if (touch > 0.0)
+	    printtouch(num_tracefiles, mm_stats, touch);
+	if (steady_iters > 0)
+	    printsteady(num_tracefiles, mm_stats);
+	if (timeline_interval > 0)
+	    printtimeline(num_tracefiles, mm_stats);
+	printprobes(num_tracefiles, mm_stats);
+	printf("\n");
+    }
+
+    /* Compare the allocators side by side */
+    if (num_backends > 1) {
+	printcompare(num_tracefiles, stats);
 	printf("\n");
     }
 
@@ -363,9 +669,368 @@ int main(int argc, char **argv)
 	printf("perfidx:%.0f\n", perfindex);
     }
 
-    exit(0);
+    /* Export the results and check them against the baseline */
+    if (outfile != NULL)
+	write_results(outfile, tracefiles, num_tracefiles, stats, perfindex);
+    if (timeline_interval > 0)
+	write_timeline(timelinefile, tracefiles, num_tracefiles, mm_stats);
+    if (baselinefile != NULL)
+	regressed = compare_baseline(baselinefile, tracefiles,
+				     num_tracefiles, mm_stats);
+
+    exit(regressed ? 2 : 0);
+}
+
+
+/*****************************************************************
+ * The following routines evaluate a package on one trace file, and
+ * farm the trace files out to worker processes.
+ ****************************************************************/
+
+/*
+ * eval_backend_trace - Evaluate the allocator cur_backend (libc malloc
+ *     or one loaded from a shared library) on trace file number i,
+ *     storing the results in *stats
+ */
+static void eval_backend_trace(char *tracefile, int i, stats_t *stats)
+{
+    backend_t *b = cur_backend;
+    trace_t *trace = read_trace(tracedir, tracefile);
+    speed_t speed_params;      /* input parameters to the xx_speed routines */ 
+
+    stats->ops = trace->num_ops;
+    if (verbose > 1)
+	printf("Checking %s malloc for correctness, ", b->name);
+    stats->valid = eval_backend_valid(trace, i, b, &stats->util);
+    if (stats->valid) {
+	if (b->heapsize != NULL)
+	    stats->heap = b->heapsize();
+	speed_params.trace = trace;
+	speed_params.backend = b;
+	if (verbose > 1)
+	    printf("and performance.\n");
+	stats->secs = fsecs_ci(eval_backend_speed, &speed_params,
+			       &stats->secs_lo, &stats->secs_hi);
+	if (run_lat) {
+	    if ((stats->lat = malloc(sizeof(lat_t))) == NULL)
+		unix_error("malloc failed in eval_backend_trace");
+	    if (b->init() < 0)
+		app_error("init failed in eval_backend_trace");
+	    eval_lat(trace, stats->lat, b->malloc_f, b->free_f, b->realloc_f);
+	}
+	if (run_perf) {
+	    if ((stats->perf = malloc(sizeof(perf_counts_t))) == NULL)
+		unix_error("malloc failed in eval_backend_trace");
+	    perf_start();
+	    eval_backend_speed(&speed_params);
+	    perf_stop(stats->perf);
+	}
+	if (touch > 0.0) {
+	    speed_params.touch = touch;
+	    eval_touch_timed(b, &speed_params, stats);
+	}
+    }
+    free_trace(trace);
+}
+
+/*
+ * eval_mm_trace - Evaluate the student's mm malloc package on trace
+ *     file number i, storing the results in *stats
+ */
+static void eval_mm_trace(char *tracefile, int i, stats_t *stats)
+{
+    static int heap_ready = 0; /* has this process called mem_init? */
+    static range_t *ranges = NULL; /* keeps track of block extents */
+    trace_t *trace;
+    speed_t speed_params;      /* input parameters to the xx_speed routines */ 
+    mm_probes_t probes;
+    mm_stats_t heap_stats;
+
+    /* Initialize the simulated memory system in memlib.c */
+    if (!heap_ready) {
+	mem_init(); 
+	heap_ready = 1;
+    }
+
+    trace = read_trace(tracedir, tracefile);
+    stats->ops = trace->num_ops;
+    if (verbose > 1)
+	printf("Checking mm_malloc for correctness, ");
+    if (single_pass) {
+	/* Collect the utilization during the validity pass */
+	stats->valid = eval_mm_valid(trace, i, &ranges, sample, &stats->util);
+    } else {
+	stats->valid = eval_mm_valid(trace, i, &ranges, 1, NULL);
+	if (stats->valid) {
+	    if (verbose > 1)
+		printf("efficiency, ");
+	    stats->util = eval_mm_util(trace, i, &ranges);
+	}
+    }
+    if (stats->valid) {
+	stats->heap = mem_heapsize();
+	mm_get_stats(&heap_stats);
+	stats->sbrks = heap_stats.sbrk_count;
+	speed_params.trace = trace;
+	speed_params.ranges = ranges;
+	if (verbose > 1)
+	    printf("and performance.\n");
+	stats->secs = fsecs_ci(eval_mm_speed, &speed_params,
+			       &stats->secs_lo, &stats->secs_hi);
+	if (run_lat) {
+	    if ((stats->lat = malloc(sizeof(lat_t))) == NULL)
+		unix_error("malloc failed in eval_mm_trace");
+	    eval_mm_lat(trace, stats->lat);
+	}
+	if (run_perf) {
+	    if ((stats->perf = malloc(sizeof(perf_counts_t))) == NULL)
+		unix_error("malloc failed in eval_mm_trace");
+	    perf_start();
+	    eval_mm_speed(&speed_params);
+	    perf_stop(stats->perf);
+	}
+	if (evlog_prefix != NULL)
+	    eval_mm_evlog(&speed_params, i);
+	if (verbose && mm_get_probes(&probes)) {
+	    /* Count the hot-path work of one untimed replay */
+	    if ((stats->probes = malloc(sizeof(mm_probes_t))) == NULL)
+		unix_error("malloc failed in eval_mm_trace");
+	    eval_mm_speed(&speed_params);
+	    mm_get_probes(stats->probes);
+	}
+	if (touch > 0.0) {
+	    speed_params.touch = touch;
+	    eval_touch_timed(&backends[0], &speed_params, stats);
+	}
+	if (steady_iters > 0)
+	    stats->steady = eval_mm_steady(trace, steady_iters, steady_warm);
+	if (timeline_interval > 0)
+	    stats->timeline = eval_mm_timeline(trace, timeline_interval);
+    }
+    free_trace(trace);
+}
+
+/*
+ * write_all, read_all - Move exactly len bytes through a pipe
+ */
+static void write_all(int fd, const void *buf, size_t len)
+{
+    const char *p = buf;
+    ssize_t n;
+
+    while (len > 0) {
+	if ((n = write(fd, p, len)) < 0) {
+	    if (errno == EINTR)
+		continue;
+	    unix_error("write failed in write_all");
+	}
+	p += n;
+	len -= n;
+    }
+}
+
+static int read_all(int fd, void *buf, size_t len)
+{
+    char *p = buf;
+    ssize_t n;
+
+    while (len > 0) {
+	if ((n = read(fd, p, len)) < 0) {
+	    if (errno == EINTR)
+		continue;
+	    unix_error("read failed in read_all");
+	}
+	if (n == 0)
+	    return 0;
+	p += n;
+	len -= n;
+    }
+    return 1;
+}
+
+/*
+ * send_stats - Send the results for trace i, including the optional
+ *     measurements they point to, from a worker to the parent
+ */
+static void send_stats(int fd, int i, stats_t *stats)
+{
+    write_all(fd, &i, sizeof(int));
+    write_all(fd, stats, sizeof(stats_t));
+    if (stats->lat != NULL)
+	write_all(fd, stats->lat, sizeof(lat_t));
+    if (stats->perf != NULL)
+	write_all(fd, stats->perf, sizeof(perf_counts_t));
+    if (stats->steady != NULL) {
+	write_all(fd, stats->steady, sizeof(steady_t));
+	write_all(fd, stats->steady->iter,
+		  stats->steady->iters * sizeof(iter_t));
+    }
+    if (stats->timeline != NULL) {
+	write_all(fd, stats->timeline, sizeof(timeline_t));
+	write_all(fd, stats->timeline->sample,
+		  stats->timeline->n * sizeof(sample_t));
+    }
+    if (stats->probes != NULL)
+	write_all(fd, stats->probes, sizeof(mm_probes_t));
+}
+
+/*
+ * recv_stats - Receive the results sent by send_stats into the stats
+ *     array. The pointers in the received stats_t only say which
+ *     optional measurements follow. Returns the trace number, or -1
+ *     at the end of the worker's results.
+ */
+static int recv_stats(int fd, stats_t *stats_array)
+{
+    int i;
+    stats_t *stats;
+
+    if (!read_all(fd, &i, sizeof(int)) || i < 0)
+	return -1;
+    stats = &stats_array[i];
+    if (!read_all(fd, stats, sizeof(stats_t)))
+	app_error("worker exited early in recv_stats");
+    if (stats->lat != NULL) {
+	if ((stats->lat = malloc(sizeof(lat_t))) == NULL)
+	    unix_error("malloc failed in recv_stats");
+	read_all(fd, stats->lat, sizeof(lat_t));
+    }
+    if (stats->perf != NULL) {
+	if ((stats->perf = malloc(sizeof(perf_counts_t))) == NULL)
+	    unix_error("malloc failed in recv_stats");
+	read_all(fd, stats->perf, sizeof(perf_counts_t));
+    }
+    if (stats->steady != NULL) {
+	if ((stats->steady = malloc(sizeof(steady_t))) == NULL)
+	    unix_error("malloc failed in recv_stats");
+	read_all(fd, stats->steady, sizeof(steady_t));
+	if ((stats->steady->iter = calloc(stats->steady->iters + 1,
+					  sizeof(iter_t))) == NULL)
+	    unix_error("malloc failed in recv_stats");
+	read_all(fd, stats->steady->iter,
+		 stats->steady->iters * sizeof(iter_t));
+    }
+    if (stats->timeline != NULL) {
+	if ((stats->timeline = malloc(sizeof(timeline_t))) == NULL)
+	    unix_error("malloc failed in recv_stats");
+	read_all(fd, stats->timeline, sizeof(timeline_t));
+	if ((stats->timeline->sample = malloc(stats->timeline->n *
+					      sizeof(sample_t))) == NULL)
+	    unix_error("malloc failed in recv_stats");
+	read_all(fd, stats->timeline->sample,
+		 stats->timeline->n * sizeof(sample_t));
+    }
+    if (stats->probes != NULL) {
+	if ((stats->probes = malloc(sizeof(mm_probes_t))) == NULL)
+	    unix_error("malloc failed in recv_stats");
+	read_all(fd, stats->probes, sizeof(mm_probes_t));
+    }
+    return i;
 }
 
+/*
+ * run_traces - Evaluate a package on each of the n trace files with
+ *     eval_trace, storing the results in stats[0..n-1]. With more than
+ *     one worker, the traces are shared out to that many child
+ *     processes, each pinned to its own CPU and with its own simulated
+ *     heap. Workers take the next unclaimed trace from a counter in
+ *     shared memory and send their results back over a pipe of their
+ *     own, so that their records cannot interleave.
+ */
+static void run_traces(char **tracefiles, int n, int workers,
+		       void (*eval_trace)(char *, int, stats_t *),
+		       stats_t *stats)
+{
+    cpu_set_t allowed, mine;
+    int cpus[CPU_SETSIZE], ncpus = 0;
+    int fds[2], i, w, left, status, werrors;
+    struct pollfd *pfds;
+    volatile int *next;
+    pid_t pid;
+
+    /* Use at most one worker per CPU we may run on, and per trace */
+    if (workers > 1 && sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+	for (i = 0; i < CPU_SETSIZE; i++)
+	    if (CPU_ISSET(i, &allowed))
+		cpus[ncpus++] = i;
+    if (workers > ncpus)
+	workers = ncpus;
+    if (workers > n)
+	workers = n;
+
+    if (workers <= 1) {
+	for (i = 0; i < n; i++)
+	    eval_trace(tracefiles[i], i, &stats[i]);
+	return;
+    }
+
+    next = mmap(NULL, sizeof(int), PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (next == MAP_FAILED)
+	unix_error("mmap failed in run_traces");
+    *next = 0;
+    if ((pfds = calloc(workers, sizeof(struct pollfd))) == NULL)
+	unix_error("calloc failed in run_traces");
+    fflush(stdout);
+
+    for (w = 0; w < workers; w++) {
+	if (pipe(fds) < 0)
+	    unix_error("pipe failed in run_traces");
+	if ((pid = fork()) < 0)
+	    unix_error("fork failed in run_traces");
+	if (pid == 0) {
+	    /* Worker: pin to a CPU, then evaluate traces until none remain */
+	    for (i = 0; i < w; i++)
+		close(pfds[i].fd);
+	    close(fds[0]);
+	    CPU_ZERO(&mine);
+	    CPU_SET(cpus[w], &mine);
+	    sched_setaffinity(0, sizeof(mine), &mine);
+	    if (run_perf)
+		perf_init(0); /* count this process, not the parent */
+	    while ((i = __sync_fetch_and_add(next, 1)) < n) {
+		memset(&stats[i], 0, sizeof(stats_t));
+		eval_trace(tracefiles[i], i, &stats[i]);
+		fflush(stdout);
+		send_stats(fds[1], i, &stats[i]);
+	    }
+	    i = -1;
+	    write_all(fds[1], &i, sizeof(int));
+	    write_all(fds[1], &errors, sizeof(int));
+	    exit(0);
+	}
+	close(fds[1]);
+	pfds[w].fd = fds[0];
+	pfds[w].events = POLLIN;
+    }
+
+    /* Parent: collect the results until every worker has finished. A
+       worker writes each record whole, so read all of it once it starts */
+    for (left = workers; left > 0; ) {
+	if (poll(pfds, workers, -1) < 0) {
+	    if (errno == EINTR)
+		continue;
+	    unix_error("poll failed in run_traces");
+	}
+	for (w = 0; w < workers; w++) {
+	    if (pfds[w].fd < 0 || pfds[w].revents == 0)
+		continue;
+	    if (recv_stats(pfds[w].fd, stats) < 0) {
+		if (!read_all(pfds[w].fd, &werrors, sizeof(int)))
+		    app_error("worker exited early in run_traces");
+		errors += werrors;
+		close(pfds[w].fd);
+		pfds[w].fd = -1;   /* poll skips it from now on */
+		left--;
+	    }
+	}
+    }
+    free(pfds);
+    while (wait(&status) > 0)
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+	    app_error("worker failed in run_traces");
+    munmap((void *)next, sizeof(int));
+}
 
 /*****************************************************************
  * The following routines manipulate the range list, which keeps 
@@ -386,24 +1051,9 @@ static int add_range(range_t **ranges, char *lo, int size,
     range_t *p;
     char msg[MAXLINE];
 
-    assert(size > 0);
-
-    /* Payload addresses must be ALIGNMENT-byte aligned */
-    if (!IS_ALIGNED(lo)) {
-	sprintf(msg, "Payload address (%p) not aligned to %d bytes", 
-		lo, ALIGNMENT);
-        malloc_error(tracenum, opnum, msg);
-        return 0;
-    }
-
-    /* The payload must lie within the extent of the heap */
-    if ((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) || 
-	(hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi())) {
-	sprintf(msg, "Payload (%p:%p) lies outside heap (%p:%p)",
-		lo, hi, mem_heap_lo(), mem_heap_hi());
-	malloc_error(tracenum, opnum, msg);
-        return 0;
-    }
+    /* The payload must be aligned and lie within the heap */
+    if (check_range(lo, size, tracenum, opnum) == 0)
+	return 0;
 
     /* The payload must not overlap any other payloads */
     for (p = *ranges;  p != NULL;  p = p->next) {
@@ -451,6 +1101,86 @@ static void remove_range(range_t **ranges, char *lo)
     }
 }
 
+/*
+ * check_range - Check that a new block of size bytes at addr lo is
+ *     aligned and lies within the heap. Returns 1 if it does.
+ */
+static int check_range(char *lo, int size, int tracenum, int opnum)
+{
+    char *hi = lo + size - 1;
+    char msg[MAXLINE];
+    int r;
+
+    assert(size > 0);
+
+    /* Payload addresses must be ALIGNMENT-byte aligned */
+    if (!IS_ALIGNED(lo)) {
+	sprintf(msg, "Payload address (%p) not aligned to %d bytes", 
+		lo, ALIGNMENT);
+        malloc_error(tracenum, opnum, msg);
+        return 0;
+    }
+
+    /* The payload must lie within one region of the heap, not in the
+       space between them */
+    for (r = 0; r < MEM_NREGIONS; r++)
+	if ((lo >= (char *)mem_region_lo(r)) && (hi <= (char *)mem_region_hi(r)))
+	    return 1;
+    sprintf(msg, "Payload (%p:%p) lies outside heap (%p:%p)",
+	    lo, hi, mem_heap_lo(), mem_heap_hi());
+    malloc_error(tracenum, opnum, msg);
+    return 0;
+}
+
+/*
+ * cmp_block_addr - Order block ids by the address of their payloads
+ */
+static trace_t *cmp_trace; /* the trace whose blocks are being sorted */
+
+static int cmp_block_addr(const void *a, const void *b)
+{
+    char *pa = cmp_trace->blocks[*(const unsigned *)a];
+    char *pb = cmp_trace->blocks[*(const unsigned *)b];
+
+    return (pa > pb) - (pa < pb);
+}
+
+/*
+ * check_overlaps - Check that none of the allocated blocks of a trace
+ *     (those whose ids are marked in live) overlap, by sorting them by
+ *     address and comparing neighbors. Returns 1 if none do.
+ */
+static int check_overlaps(trace_t *trace, char *live, int tracenum,
+			  int opnum)
+{
+    unsigned *ids, n = 0, i;
+    char msg[MAXLINE];
+    int ok = 1;
+
+    if ((ids = malloc(trace->num_ids * sizeof(unsigned))) == NULL)
+	unix_error("malloc failed in check_overlaps");
+    for (i = 0; i < trace->num_ids; i++)
+	if (live[i])
+	    ids[n++] = i;
+    cmp_trace = trace;
+    qsort(ids, n, sizeof(unsigned), cmp_block_addr);
+
+    for (i = 1; i < n && ok; i++) {
+	char *prev_lo = trace->blocks[ids[i-1]];
+	char *prev_hi = prev_lo + trace->block_sizes[ids[i-1]] - 1;
+	char *lo = trace->blocks[ids[i]];
+
+	if (lo <= prev_hi) {
+	    sprintf(msg, "Payload (%p:%p) overlaps another payload (%p:%p)\n",
+		    lo, lo + trace->block_sizes[ids[i]] - 1, prev_lo, prev_hi);
+	    malloc_error(tracenum, opnum, msg);
+	    ok = 0;
+	}
+    }
+    free(ids);
+    return ok;
+}
+
 /*
  * clear_ranges - free all of the range records for a trace 
  */
@@ -576,8 +1306,19 @@ void free_trace(trace_t *trace)
 
 /*
  * eval_mm_valid - Check the mm malloc package for correctness
+ *
+ *    With sample <= 1, every new block is checked against the range
+ *    list of all allocated blocks. Otherwise only the cheap per-block
+ *    checks (alignment, heap bounds, realloc preserving the data) are
+ *    done on every request, and the allocated blocks are checked for
+ *    overlaps every "sample" requests and at the end. If util is not
+ *    NULL, the space utilization of the replay is stored there, as
+ *    eval_mm_util would compute it. With -c, the mm package's own
+ *    checkers also run: mm_check_op after every request, and
+ *    mm_check_heap every check_interval requests and at the end.
  */
-static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges) 
+static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges,
+			 int sample, double *util) 
 {
     unsigned i, j;
     int index;
@@ -586,14 +1327,19 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
     char *newp;
     char *oldp;
     char *p;
+    char *live = NULL;
+    int total_size = 0, max_total_size = 0;
     
     /* Reset the heap and free any records in the range list */
     mem_reset_brk();
     clear_ranges(ranges);
+    if (sample > 1 && (live = calloc(trace->num_ids, 1)) == NULL)
+	unix_error("calloc failed in eval_mm_valid");
 
     /* Call the mm package's init function */
     if (mm_init() < 0) {
 	malloc_error(tracenum, 0, "mm_init failed.");
+	free(live);
 	return 0;
     }
 
@@ -609,6 +1355,7 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    /* Call the student's malloc */
 	    if ((p = mm_malloc(size)) == NULL) {
 		malloc_error(tracenum, i, "mm_malloc failed.");
+		free(live);
 		return 0;
 	    }
 	    
@@ -617,8 +1364,11 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	     * to the range list if OK. The block must be  be aligned properly,
 	     * and must not overlap any currently allocated block. 
 	     */ 
-	    if (add_range(ranges, p, size, tracenum, i) == 0)
+	    if (live == NULL ? add_range(ranges, p, size, tracenum, i) == 0 :
+		check_range(p, size, tracenum, i) == 0) {
+		free(live);
 		return 0;
+	    }
 	    
 	    /* ADDED: cgw
 	     * fill range with low byte of index.  This will be used later
@@ -630,6 +1380,9 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    /* Remember region */
 	    trace->blocks[index] = p;
 	    trace->block_sizes[index] = size;
+	    if (live != NULL)
+		live[index] = 1;
+	    total_size += size;
 	    break;
 
         case REALLOC: /* mm_realloc */
@@ -638,15 +1391,20 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    oldp = trace->blocks[index];
 	    if ((newp = mm_realloc(oldp, size)) == NULL) {
 		malloc_error(tracenum, i, "mm_realloc failed.");
+		free(live);
 		return 0;
 	    }
 	    
 	    /* Remove the old region from the range list */
-	    remove_range(ranges, oldp);
+	    if (live == NULL)
+		remove_range(ranges, oldp);
 	    
 	    /* Check new block for correctness and add it to range list */
-	    if (add_range(ranges, newp, size, tracenum, i) == 0)
+	    if (live == NULL ? add_range(ranges, newp, size, tracenum, i) == 0 :
+		check_range(newp, size, tracenum, i) == 0) {
+		free(live);
 		return 0;
+	    }
 	    
 	    /* ADDED: cgw
 	     * Make sure that the new block contains the data from the old 
@@ -654,11 +1412,13 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	     * of the new index
 	     */
 	    oldsize = trace->block_sizes[index];
+	    total_size += size - oldsize;
 	    if (size < oldsize) oldsize = size;
 	    for (j = 0; j < oldsize; j++) {
-	      if (newp[j] != (index & 0xFF)) {
+	      if ((unsigned char)newp[j] != (index & 0xFF)) {
 		malloc_error(tracenum, i, "mm_realloc did not preserve the "
 			     "data from old block");
+		free(live);
 		return 0;
 	      }
 	    }
@@ -673,7 +1433,11 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    
 	    /* Remove region from list and call student's free function */
 	    p = trace->blocks[index];
-	    remove_range(ranges, p);
+	    if (live == NULL)
+		remove_range(ranges, p);
+	    else
+		live[index] = 0;
+	    total_size -= trace->block_sizes[index];
 	    mm_free(p);
 	    break;
 
@@ -681,7 +1445,30 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    app_error("Nonexistent request type in eval_mm_valid");
         }
 
+	if (total_size > max_total_size)
+	    max_total_size = total_size;
+
+	/* Check the blocks that the request touched, and now and then all */
+	if (check_interval > 0 &&
+	    (mm_check_op() != 0 ||
+	     (((i + 1) % check_interval == 0 || i + 1 == trace->num_ops) &&
+	      mm_check_heap() != 0))) {
+	    malloc_error(tracenum, i, "mm heap check failed.");
+	    free(live);
+	    return 0;
+	}
+
+	/* Periodically check all of the allocated blocks for overlaps */
+	if (live != NULL && ((i + 1) % sample == 0 || i + 1 == trace->num_ops) &&
+	    check_overlaps(trace, live, tracenum, i) == 0) {
+	    free(live);
+	    return 0;
+	}
     }
+    free(live);
+
+    if (util != NULL)
+	*util = (double)max_total_size / (double)mem_heapsize();
 
     /* As far as we know, this is a valid malloc package */
     return 1;
@@ -833,68 +1620,328 @@ static void eval_mm_speed(void *ptr)
 }
 
 /*
- * eval_libc_valid - We run this function to make sure that the
- *    libc malloc can run to completion on the set of traces.
- *    We'll be conservative and terminate if any libc malloc call fails.
- *
+ * eval_mm_lat - Replay a trace on a fresh mm heap, recording the
+ *    latency of every request.
  */
-static int eval_libc_valid(trace_t *trace, int tracenum)
+static void eval_mm_lat(trace_t *trace, lat_t *lat)
 {
-    unsigned i, newsize;
-    char *p, *newp, *oldp;
+    mem_reset_brk();
+    if (mm_init() < 0)
+	app_error("mm_init failed in eval_mm_lat");
+    eval_lat(trace, lat, mm_malloc, mm_free, mm_realloc);
+}
 
-    for (i = 0;  i < trace->num_ops;  i++) {
-        switch (trace->ops[i].type) {
+/*
+ * take_sample - Record the state of the mm package's heap in *s
+ */
+static void take_sample(sample_t *s, unsigned op, double live)
+{
+    mm_stats_t st;
+    int c;
+
+    mm_get_stats(&st);
+    s->op = op;
+    s->live = live;
+    s->heap = st.heap_size;
+    s->free = st.free_bytes;
+    s->largest = st.largest_free;
+    for (c = 0; c < MM_NCLASSES; c++)
+	s->class_free[c] = st.class_bytes[c];
+}
 
-        case ALLOC: /* malloc */
-	    if ((p = malloc(trace->ops[i].size)) == NULL) {
-		malloc_error(tracenum, i, "libc malloc failed");
-		unix_error("System message");
-	    }
-	    trace->blocks[trace->ops[i].index] = p;
-	    break;
+/*
+ * eval_mm_evlog - Replay a trace on a fresh mm heap, writing the mm
+ *     package's event log to <evlog_prefix><tracenum>.evl
+ */
+static void eval_mm_evlog(speed_t *params, int tracenum)
+{
+    char name[MAXLINE];
+    int fd;
+
+    snprintf(name, sizeof(name), "%s%d.evl", evlog_prefix, tracenum);
+    if ((fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+	unix_error("open failed in eval_mm_evlog");
+    mm_evlog_attach(fd);
+    eval_mm_speed(params);
+    mm_evlog_attach(-1);
+    close(fd);
+}
 
-	case REALLOC: /* realloc */
-            newsize = trace->ops[i].size;
-	    oldp = trace->blocks[trace->ops[i].index];
-	    if ((newp = realloc(oldp, newsize)) == NULL) {
-		malloc_error(tracenum, i, "libc realloc failed");
-		unix_error("System message");
-	    }
-	    trace->blocks[trace->ops[i].index] = newp;
+/*
+ * eval_mm_timeline - Replay a trace on a fresh heap, sampling the live
+ *     payload bytes, the heap size and the free blocks in each size
+ *     class every "interval" ops and after the last op. This shows when
+ *     the heap grows and when fragmentation sets in, rather than only
+ *     the utilization at the end.
+ */
+static timeline_t *eval_mm_timeline(trace_t *trace, unsigned interval)
+{
+    timeline_t *timeline;
+    unsigned i;
+    int index;
+    double live = 0.0;
+    char *p;
+
+    if ((timeline = malloc(sizeof(timeline_t))) == NULL ||
+	(timeline->sample = malloc((trace->num_ops / interval + 1) *
+				   sizeof(sample_t))) == NULL)
+	unix_error("malloc failed in eval_mm_timeline");
+    timeline->n = 0;
+    timeline->interval = interval;
+
+    mem_reset_brk();
+    if (mm_init() < 0)
+	app_error("mm_init failed in eval_mm_timeline");
+
+    for (i = 0; i < trace->num_ops; i++) {
+	index = trace->ops[i].index;
+	switch (trace->ops[i].type) {
+	case ALLOC:
+	    if ((p = mm_malloc(trace->ops[i].size)) == NULL)
+		app_error("mm_malloc failed in eval_mm_timeline");
+	    trace->blocks[index] = p;
+	    trace->block_sizes[index] = trace->ops[i].size;
+	    live += trace->ops[i].size;
 	    break;
-	    
-        case FREE: /* free */
-	    free(trace->blocks[trace->ops[i].index]);
+	case REALLOC:
+	    if ((p = mm_realloc(trace->blocks[index],
+				trace->ops[i].size)) == NULL)
+		app_error("mm_realloc failed in eval_mm_timeline");
+	    live += (double)trace->ops[i].size - trace->block_sizes[index];
+	    trace->blocks[index] = p;
+	    trace->block_sizes[index] = trace->ops[i].size;
+	    break;
+	case FREE:
+	    mm_free(trace->blocks[index]);
+	    live -= trace->block_sizes[index];
 	    break;
-
 	default:
-	    app_error("invalid operation type  in eval_libc_valid");
+	    app_error("Nonexistent request type in eval_mm_timeline");
 	}
+	if ((i + 1) % interval == 0 || i + 1 == trace->num_ops)
+	    take_sample(&timeline->sample[timeline->n++], i + 1, live);
     }
-
-    return 1;
+    return timeline;
 }
 
-/* 
- * eval_libc_speed - This is the function that is used by fcyc() to
- *    measure the running time of the libc malloc package on the set
- *    of traces.
+/*
+ * eval_mm_steady - Replay a trace "iters" times on one heap, without
+ *    calling mm_init between iterations, to see how the allocator
+ *    behaves once its heap has aged. Before the first iteration, the
+ *    heap is pre-fragmented by allocating "warm" blocks (cycling
+ *    through the trace's own request sizes) and freeing every other
+ *    one; the rest stay allocated, pinning the free space apart.
+ *    Returns the time and utilization of each iteration.
  */
-static void eval_libc_speed(void *ptr)
+static steady_t *eval_mm_steady(trace_t *trace, int iters, int warm)
 {
-    unsigned i;
-    int index, size, newsize;
+    steady_t *steady;
+    char **pinned;
+    unsigned i, size;
+    int it, w, nsizes = 0;
+    long pinned_size = 0;
+
+    if ((steady = malloc(sizeof(steady_t))) == NULL ||
+	(steady->iter = calloc(iters, sizeof(iter_t))) == NULL ||
+	(pinned = calloc(warm + 1, sizeof(char *))) == NULL)
+	unix_error("malloc failed in eval_mm_steady");
+    steady->warm = warm;
+    steady->exhausted = 0;
+
+    mem_reset_brk();
+    if (mm_init() < 0)
+	app_error("mm_init failed in eval_mm_steady");
+
+    /* Age the heap, keeping the odd-numbered blocks allocated */
+    for (i = 0; i < trace->num_ops; i++)
+	if (trace->ops[i].type != FREE)
+	    nsizes++;
+    for (w = 0, i = 0; w < warm && nsizes > 0; w++) {
+	while (trace->ops[i].type == FREE)
+	    i = (i + 1) % trace->num_ops;
+	size = trace->ops[i].size;
+	i = (i + 1) % trace->num_ops;
+	if ((pinned[w] = mm_malloc(size)) == NULL)
+	    break;
+	if (w % 2)
+	    pinned_size += size;
+    }
+
+    /* Give up on the trace if the warm-up alone runs out of memory */
+    if (w < warm && nsizes > 0) {
+	while (w-- > 0)
+	    mm_free(pinned[w]);
+	steady->exhausted = 1;
+	steady->iters = 0;
+	free(pinned);
+	return steady;
+    }
+    for (w = 0; w < warm && nsizes > 0; w += 2)
+	mm_free(pinned[w]);
+
+    /* Stop early if the aged heap runs out of memory */
+    for (it = 0; it < iters; it++) {
+	if (steady_iter(trace, pinned_size, &steady->iter[it]) == 0) {
+	    steady->exhausted = 1;
+	    break;
+	}
+    }
+    steady->iters = it;
+
+    free(pinned);
+    return steady;
+}
+
+/*
+ * steady_iter - Run one iteration of eval_mm_steady, on top of the
+ *    pinned_size payload bytes left allocated by the warm-up. Returns
+ *    0 if the allocator ran out of memory, and 1 otherwise.
+ */
+static int steady_iter(trace_t *trace, long pinned_size, iter_t *iter)
+{
+    unsigned i, index, size;
+    char *p;
+    long total_size, max_total_size;
+    uint64_t start;
+
+    total_size = max_total_size = pinned_size;
+    start = lat_now();
+    for (i = 0;  i < trace->num_ops;  i++) {
+	index = trace->ops[i].index;
+	size = trace->ops[i].size;
+
+	switch (trace->ops[i].type) {
+	case ALLOC: /* mm_malloc */
+	    if ((p = mm_malloc(size)) == NULL)
+		return 0;
+	    trace->blocks[index] = p;
+	    trace->block_sizes[index] = size;
+	    total_size += size;
+	    break;
+
+	case REALLOC: /* mm_realloc */
+	    if ((p = mm_realloc(trace->blocks[index], size)) == NULL)
+		return 0;
+	    total_size += (long)size - (long)trace->block_sizes[index];
+	    trace->blocks[index] = p;
+	    trace->block_sizes[index] = size;
+	    break;
+
+	case FREE: /* mm_free */
+	    mm_free(trace->blocks[index]);
+	    total_size -= trace->block_sizes[index];
+	    break;
+
+	default:
+	    app_error("Nonexistent request type in steady_iter");
+	}
+	if (total_size > max_total_size)
+	    max_total_size = total_size;
+    }
+    iter->secs = (lat_now() - start) / lat_ticks_per_ns() / 1e9;
+    iter->heap = mem_heapsize();
+    iter->util = (double)max_total_size / mem_heapsize();
+    return 1;
+}
+
+/*
+ * eval_backend_valid - We run this function to make sure that the
+ *    allocator backend b can run to completion on the set of traces,
+ *    and that realloc preserves the contents of each block. The mm
+ *    package has its own, more thorough checker, eval_mm_valid. If the
+ *    backend reports its heap size, the space utilization of the
+ *    replay is stored in *util.
+ */
+static int eval_backend_valid(trace_t *trace, int tracenum, backend_t *b,
+			      double *util)
+{
+    unsigned i, j, index, size, oldsize;
+    char *p, *newp;
+    double total_size = 0.0, max_total_size = 0.0;
+
+    if (b->init() < 0) {
+	malloc_error(tracenum, 0, "init failed.");
+	return 0;
+    }
+
+    for (i = 0;  i < trace->num_ops;  i++) {
+	index = trace->ops[i].index;
+	size = trace->ops[i].size;
+
+        switch (trace->ops[i].type) {
+
+        case ALLOC: /* malloc */
+	    if ((p = b->malloc_f(size)) == NULL) {
+		malloc_error(tracenum, i, "malloc failed.");
+		return 0;
+	    }
+	    memset(p, index & 0xFF, size);
+	    trace->blocks[index] = p;
+	    trace->block_sizes[index] = size;
+	    total_size += size;
+	    break;
+
+	case REALLOC: /* realloc */
+	    if ((newp = b->realloc_f(trace->blocks[index], size)) == NULL) {
+		malloc_error(tracenum, i, "realloc failed.");
+		return 0;
+	    }
+	    oldsize = trace->block_sizes[index];
+	    if (size < oldsize)
+		oldsize = size;
+	    for (j = 0; j < oldsize; j++) {
+		if ((unsigned char)newp[j] != (index & 0xFF)) {
+		    malloc_error(tracenum, i, "realloc did not preserve the "
+				 "data from old block");
+		    return 0;
+		}
+	    }
+	    memset(newp, index & 0xFF, size);
+	    total_size += (double)size - trace->block_sizes[index];
+	    trace->blocks[index] = newp;
+	    trace->block_sizes[index] = size;
+	    break;
+	    
+        case FREE: /* free */
+	    b->free_f(trace->blocks[index]);
+	    total_size -= trace->block_sizes[index];
+	    break;
+
+	default:
+	    app_error("invalid operation type  in eval_backend_valid");
+	}
+	if (total_size > max_total_size)
+	    max_total_size = total_size;
+    }
+
+    if (b->heapsize != NULL && b->heapsize() > 0)
+	*util = max_total_size / b->heapsize();
+    return 1;
+}
+
+/* 
+ * eval_backend_speed - This is the function that is used by fcyc() to
+ *    measure the running time of an allocator backend on the set of
+ *    traces.
+ */
+static void eval_backend_speed(void *ptr)
+{
+    unsigned i;
+    int index, size, newsize;
     char *p, *newp, *oldp, *block;
     trace_t *trace = ((speed_t *)ptr)->trace;
+    backend_t *b = ((speed_t *)ptr)->backend;
+
+    if (b->init() < 0)
+	app_error("init failed in eval_backend_speed");
 
     for (i = 0;  i < trace->num_ops;  i++) {
         switch (trace->ops[i].type) {
         case ALLOC: /* malloc */
 	    index = trace->ops[i].index;
 	    size = trace->ops[i].size;
-	    if ((p = malloc(size)) == NULL)
-		unix_error("malloc failed in eval_libc_speed");
+	    if ((p = b->malloc_f(size)) == NULL)
+		unix_error("malloc failed in eval_backend_speed");
 	    trace->blocks[index] = p;
 	    break;
 
@@ -902,8 +1949,8 @@ static void eval_libc_speed(void *ptr)
 	    index = trace->ops[i].index;
 	    newsize = trace->ops[i].size;
 	    oldp = trace->blocks[index];
-	    if ((newp = realloc(oldp, newsize)) == NULL)
-		unix_error("realloc failed in eval_libc_speed\n");
+	    if ((newp = b->realloc_f(oldp, newsize)) == NULL)
+		unix_error("realloc failed in eval_backend_speed\n");
 	    
 	    trace->blocks[index] = newp;
 	    break;
@@ -911,10 +1958,240 @@ static void eval_libc_speed(void *ptr)
         case FREE: /* free */
 	    index = trace->ops[i].index;
 	    block = trace->blocks[index];
-	    free(block);
+	    b->free_f(block);
+	    break;
+	}
+    }
+}
+
+/*
+ * load_backend - Load an allocator from the shared library named by
+ *    spec, "path[:prefix]". The library must define <prefix>malloc,
+ *    <prefix>free and <prefix>realloc, and may define int <prefix>init
+ *    (void) to start over with an empty heap and size_t
+ *    <prefix>heapsize(void) to report its footprint.
+ */
+static void load_backend(char *spec)
+{
+    backend_t *b = &backends[num_backends];
+    char *path = strdup(spec), *prefix = "", *colon, *slash;
+    char sym[MAXLINE];
+
+    if (path == NULL)
+	unix_error("strdup failed in load_backend");
+    if ((colon = strchr(path, ':')) != NULL) {
+	*colon = '\0';
+	prefix = colon + 1;
+    }
+    if ((b->handle = dlopen(path, RTLD_NOW | RTLD_LOCAL)) == NULL) {
+	snprintf(msg, MAXLINE, "Could not load %.400s: %.400s", path, dlerror());
+	app_error(msg);
+    }
+
+    /* Name the backend after the library, e.g., "libfoo" for libfoo.so */
+    b->name = ((slash = strrchr(path, '/')) != NULL) ? slash + 1 : path;
+    if ((colon = strstr(b->name, ".so")) != NULL)
+	*colon = '\0';
+
+#define LOOKUP(field, fname, required) do {				\
+	snprintf(sym, sizeof(sym), "%s%s", prefix, fname);		\
+	*(void **)&b->field = dlsym(b->handle, sym);			\
+	if (required && b->field == NULL) {				\
+	    snprintf(msg, MAXLINE, "%.400s does not define %.400s", path, sym); \
+	    app_error(msg);						\
+	}								\
+    } while (0)
+
+    LOOKUP(malloc_f, "malloc", 1);
+    LOOKUP(free_f, "free", 1);
+    LOOKUP(realloc_f, "realloc", 1);
+    LOOKUP(init, "init", 0);
+    LOOKUP(heapsize, "heapsize", 0);
+#undef LOOKUP
+    if (b->init == NULL)
+	b->init = init_libc;
+    num_backends++;
+}
+/*
+ * eval_lat - Replay a trace once, reading the tick counter around
+ *    each call to the allocator. The sample for a request is filed
+ *    under its type and the payload size it asked for (for free, the
+ *    size of the block being freed).
+ */
+static void eval_lat(trace_t *trace, lat_t *lat, malloc_funct malloc_f,
+		     free_funct free_f, realloc_funct realloc_f)
+{
+    unsigned i, index, size;
+    char *p;
+    uint64_t start, end;
+
+    lat_init(lat);
+    for (i = 0;  i < trace->num_ops;  i++) {
+	index = trace->ops[i].index;
+	size = trace->ops[i].size;
+
+        switch (trace->ops[i].type) {
+        case ALLOC: /* malloc */
+	    start = lat_now();
+	    p = malloc_f(size);
+	    end = lat_now();
+	    if (p == NULL)
+		app_error("malloc failed in eval_lat");
+	    lat_record(lat, LAT_MALLOC, size, end - start);
+	    trace->blocks[index] = p;
+	    trace->block_sizes[index] = size;
+	    break;
+
+	case REALLOC: /* realloc */
+	    start = lat_now();
+	    p = realloc_f(trace->blocks[index], size);
+	    end = lat_now();
+	    if (p == NULL)
+		app_error("realloc failed in eval_lat");
+	    lat_record(lat, LAT_REALLOC, size, end - start);
+	    trace->blocks[index] = p;
+	    trace->block_sizes[index] = size;
+	    break;
+
+        case FREE: /* free */
+	    p = trace->blocks[index];
+	    start = lat_now();
+	    free_f(p);
+	    end = lat_now();
+	    lat_record(lat, LAT_FREE, trace->block_sizes[index], end - start);
+	    break;
+
+	default:
+	    app_error("Nonexistent request type in eval_lat");
+	}
+    }
+}
+
+/*
+ * init_mm - Reset the simulated heap and initialize the mm package
+ */
+static int init_mm(void)
+{
+    mem_reset_brk();
+    return mm_init();
+}
+
+/*
+ * init_libc - libc malloc needs no initialization
+ */
+static int init_libc(void)
+{
+    return 0;
+}
+
+/* The allocator replayed by eval_touch_speed */
+static backend_t *touch_backend;
+
+/* Keeps the compiler from discarding the reads of touched payloads */
+static volatile char touch_sink;
+
+/*
+ * eval_touch_speed - This is the function that is used by fsecs() to
+ *    measure the touching replay of the allocator selected by
+ *    eval_touch_timed.
+ */
+static void eval_touch_speed(void *ptr)
+{
+    backend_t *b = touch_backend;
+
+    if (b->init() < 0)
+	app_error("init failed in eval_touch_speed");
+    eval_touch((speed_t *)ptr, b->malloc_f, b->free_f, b->realloc_f);
+}
+
+/*
+ * eval_touch_timed - Time the touching replay of a trace with fsecs(),
+ *    and split its running time into the share spent in the allocator
+ *    (from the tick counts accumulated by eval_touch) and the total.
+ */
+static void eval_touch_timed(backend_t *b, speed_t *params, stats_t *stats)
+{
+    double ticks_per_run;
+
+    touch_backend = b;
+    params->alloc_ticks = 0;
+    params->runs = 0;
+    stats->touch_secs = fsecs(eval_touch_speed, params);
+    ticks_per_run = (double)params->alloc_ticks / params->runs;
+    stats->touch_alloc_secs = ticks_per_run / lat_ticks_per_ns() / 1e9;
+}
+
+/*
+ * touch_payload - Write one byte in each cache line of the first
+ *     "touch" fraction of a payload
+ */
+static void touch_payload(char *p, size_t size, double touch)
+{
+    size_t i, len = (size_t)(size * touch);
+
+    for (i = 0; i < len; i += CACHELINE)
+	p[i] = (char)i;
+}
+
+/*
+ * eval_touch - Replay a trace, touching part of each payload after it
+ *    is allocated and reading it back before it is freed, the way a
+ *    program would use its memory. Only the time spent inside the
+ *    allocator is added to params->alloc_ticks.
+ */
+static void eval_touch(speed_t *params, malloc_funct malloc_f,
+		       free_funct free_f, realloc_funct realloc_f)
+{
+    trace_t *trace = params->trace;
+    unsigned i, index, size;
+    size_t j, len;
+    uint64_t ticks = 0, start;
+    char *p, x = 0;
+
+    for (i = 0;  i < trace->num_ops;  i++) {
+	index = trace->ops[i].index;
+	size = trace->ops[i].size;
+
+        switch (trace->ops[i].type) {
+        case ALLOC: /* malloc */
+	    start = lat_now();
+	    p = malloc_f(size);
+	    ticks += lat_now() - start;
+	    if (p == NULL)
+		app_error("malloc failed in eval_touch");
+	    touch_payload(p, size, params->touch);
+	    trace->blocks[index] = p;
+	    trace->block_sizes[index] = size;
+	    break;
+
+	case REALLOC: /* realloc */
+	    start = lat_now();
+	    p = realloc_f(trace->blocks[index], size);
+	    ticks += lat_now() - start;
+	    if (p == NULL)
+		app_error("realloc failed in eval_touch");
+	    touch_payload(p, size, params->touch);
+	    trace->blocks[index] = p;
+	    trace->block_sizes[index] = size;
 	    break;
+
+        case FREE: /* free */
+	    p = trace->blocks[index];
+	    len = (size_t)(trace->block_sizes[index] * params->touch);
+	    for (j = 0; j < len; j += CACHELINE)
+		x += p[j];
+	    start = lat_now();
+	    free_f(p);
+	    ticks += lat_now() - start;
+	    break;
+
+	default:
+	    app_error("Nonexistent request type in eval_touch");
 	}
     }
+    touch_sink = x;
+    params->alloc_ticks += ticks;
+    params->runs++;
 }
 
 /*************************************
@@ -935,17 +2212,18 @@ static void printresults(int n, stats_t *stats)
     /* Print the individual results for each trace */
     /* All the space before the last number on each line is added by 
      * Zheng Cai, for better formatting */
-    printf("%5s%7s %5s%8s%10s %6s\n", 
-	   "trace", " valid", "util", "ops", "secs", "Kops");
+    printf("%5s%7s %5s%8s%10s %6s %6s\n", 
+	   "trace", " valid", "util", "ops", "secs", "Kops", "+/-");
     for (i=0; i < n; i++) {
 	if (stats[i].valid) {
-	    printf("%2d%10s%5.0f%%%8.0f%10.6f %6.0f\n", 
+	    printf("%2d%10s%5.0f%%%8.0f%10.6f %6.0f %5.1f%%\n", 
 		   i,
 		   "yes",
 		   stats[i].util*100.0,
 		   stats[i].ops,
 		   stats[i].secs,
-		   (stats[i].ops/1e3)/stats[i].secs);
+		   (stats[i].ops/1e3)/stats[i].secs,
+		   50.0*(stats[i].secs_hi - stats[i].secs_lo)/stats[i].secs);
 	    secs += stats[i].secs;
 	    ops += stats[i].ops;
 	    util += stats[i].util;
@@ -979,6 +2257,852 @@ static void printresults(int n, stats_t *stats)
 	       "-");
     }
 
+    /* Print the latency breakdown if it was recorded */
+    for (i=0; i < n; i++) {
+	if (stats[i].lat != NULL) {
+	    printlatency(n, stats);
+	    break;
+	}
+    }
+
+    /* Print the hardware counters if they were read */
+    for (i=0; i < n; i++) {
+	if (stats[i].perf != NULL) {
+	    printperf(n, stats);
+	    break;
+	}
+    }
+}
+
+/*
+ * printsteady - prints the throughput and utilization of each warm-heap
+ *     iteration, and their drift relative to the first iteration
+ */
+static void printsteady(int n, stats_t *stats)
+{
+    int i, it;
+
+    for (i = 0; i < n; i++) {
+	steady_t *steady = stats[i].steady;
+
+	if (!stats[i].valid || steady == NULL)
+	    continue;
+	printf("\nTrace %d on a warm heap (%d warm-up blocks):\n",
+	       i, steady->warm);
+	printf("%5s %10s %7s %6s %6s %10s\n",
+	       "iter", "secs", "Kops", "drift", "util", "heap");
+	for (it = 0; it < steady->iters; it++) {
+	    iter_t *iter = &steady->iter[it];
+
+	    printf("%5d %10.6f %7.0f %+5.0f%% %5.0f%% %10.0f\n", it,
+		   iter->secs, (stats[i].ops/1e3)/iter->secs,
+		   100.0*(steady->iter[0].secs/iter->secs - 1.0),
+		   iter->util*100.0, iter->heap);
+	}
+	if (steady->exhausted && steady->iters == 0)
+	    printf("Ran out of heap in the warm-up\n");
+	else if (steady->exhausted)
+	    printf("Ran out of heap in iteration %d\n", steady->iters);
+    }
+}
+
+/*
+ * printtimeline - prints, for each trace, where the heap peaked and
+ *     where external fragmentation (free bytes not in the largest free
+ *     block) was worst
+ */
+static void printtimeline(int n, stats_t *stats)
+{
+    int i, k, peak, worst;
+    double frag, worst_frag;
+
+    printf("\nHeap timeline (details in the timeline file):\n");
+    printf("%5s %7s %10s %8s %6s %8s\n",
+	   "trace", "samples", "peak heap", "at op", "frag", "at op");
+    for (i = 0; i < n; i++) {
+	timeline_t *tl = stats[i].timeline;
+
+	if (!stats[i].valid || tl == NULL || tl->n == 0)
+	    continue;
+	peak = worst = 0;
+	worst_frag = 0.0;
+	for (k = 0; k < tl->n; k++) {
+	    sample_t *s = &tl->sample[k];
+
+	    if (s->heap > tl->sample[peak].heap)
+		peak = k;
+	    frag = (s->free > 0.0) ? 1.0 - s->largest / s->free : 0.0;
+	    if (frag > worst_frag) {
+		worst_frag = frag;
+		worst = k;
+	    }
+	}
+	printf("%5d %7d %10.0f %8u %5.0f%% %8u\n", i, tl->n,
+	       tl->sample[peak].heap, tl->sample[peak].op,
+	       100.0*worst_frag, tl->sample[worst].op);
+    }
+}
+
+/*
+ * printprobes - prints, for each trace, the hot-path counts of an mm
+ *     package built with probes: the work per find_fit call, where place
+ *     put each block, and each coalesce case as calls/declined merges
+ */
+static void printprobes(int n, stats_t *stats)
+{
+    char buf[48];
+    int i, c;
+
+    for (i = 0; i < n; i++)
+	if (stats[i].valid && stats[i].probes != NULL)
+	    break;
+    if (i == n)
+	return;
+    printf("\nHot-path probes (one replay):\n");
+    printf("%5s %8s %7s %7s %6s %6s %6s %7s %13s %13s %13s %13s\n",
+	   "trace", "fits", "lists", "blocks", "front", "back", "whole",
+	   "extends", "co:none", "co:next", "co:prev", "co:both");
+    for (i = 0; i < n; i++) {
+	mm_probes_t *p = stats[i].probes;
+	double places;
+
+	if (!stats[i].valid || p == NULL)
+	    continue;
+	places = p->place_front + p->place_back + p->place_whole;
+	if (places == 0.0)
+	    places = 1.0;
+	printf("%5d %8zu %7.2f %7.2f %5.0f%% %5.0f%% %5.0f%% %7zu", i,
+	       p->fit_calls,
+	       p->fit_calls ? (double)p->fit_classes / p->fit_calls : 0.0,
+	       p->fit_calls ? (double)p->fit_visited / p->fit_calls : 0.0,
+	       100.0*p->place_front/places, 100.0*p->place_back/places,
+	       100.0*p->place_whole/places, p->extend_calls);
+	for (c = 0; c < 4; c++) {
+	    snprintf(buf, sizeof(buf), "%zu/%zu", p->coalesce[c],
+		     p->coalesce_declined[c]);
+	    printf(" %13s", buf);
+	}
+	printf("\n");
+    }
+}
+
+/*
+ * printgrowth - prints how the mm package's heap grew on each trace: its
+ *     final size, the calls to mem_sbrk that got it there, and the
+ *     utilization that resulted
+ */
+static void printgrowth(int n, stats_t *stats)
+{
+    int i;
+
+    printf("\nHeap growth:\n");
+    printf("%5s %10s %7s %10s %5s\n", "trace", "heap KB", "sbrks",
+	   "KB/sbrk", "util");
+    for (i = 0; i < n; i++) {
+	if (!stats[i].valid)
+	    continue;
+	printf("%5d %10.1f %7.0f %10.1f %4.0f%%\n", i, stats[i].heap / 1024,
+	       stats[i].sbrks, stats[i].heap / 1024 / stats[i].sbrks,
+	       stats[i].util*100.0);
+    }
+}
+
+/*
+ * printcompare - prints the throughput (and, where the allocator reports
+ *     its heap size, the utilization) of every allocator on every trace
+ *     side by side
+ */
+static void printcompare(int n, stats_t **stats)
+{
+    int i, b;
+    double secs, ops, util;
+
+    printf("Comparison of allocators (Kops, util):\n%5s", "trace");
+    for (b = 0; b < num_backends; b++)
+	printf(" %15.15s", backends[b].name);
+    printf("\n");
+    for (i = 0; i < n; i++) {
+	printf("%5d", i);
+	for (b = 0; b < num_backends; b++) {
+	    if (!stats[b][i].valid)
+		printf(" %15s", "-");
+	    else if (backends[b].heapsize != NULL)
+		printf(" %8.0f %5.0f%%", (stats[b][i].ops/1e3)/stats[b][i].secs,
+		       stats[b][i].util*100.0);
+	    else
+		printf(" %8.0f %6s", (stats[b][i].ops/1e3)/stats[b][i].secs,
+		       "");
+	}
+	printf("\n");
+    }
+    printf("%5s", "Total");
+    for (b = 0; b < num_backends; b++) {
+	secs = ops = util = 0.0;
+	for (i = 0; i < n; i++) {
+	    if (!stats[b][i].valid)
+		break;
+	    secs += stats[b][i].secs;
+	    ops += stats[b][i].ops;
+	    util += stats[b][i].util;
+	}
+	if (i < n)
+	    printf(" %15s", "-");
+	else if (backends[b].heapsize != NULL)
+	    printf(" %8.0f %5.0f%%", (ops/1e3)/secs, util/n*100.0);
+	else
+	    printf(" %8.0f %6s", (ops/1e3)/secs, "");
+    }
+    printf("\n");
+}
+
+/*
+ * printtouch - prints the allocator and total time of the replay that
+ *     touches each payload, next to the allocator time without touching
+ */
+static void printtouch(int n, stats_t *stats, double touch)
+{
+    int i;
+
+    printf("\nTouching %.0f%% of each payload:\n", touch*100.0);
+    printf("%5s %10s %10s %6s %10s\n",
+	   "trace", "alloc secs", "total secs", "alloc%", "untouched");
+    for (i = 0; i < n; i++) {
+	if (!stats[i].valid)
+	    continue;
+	printf("%5d %10.6f %10.6f %5.0f%% %10.6f\n", i,
+	       stats[i].touch_alloc_secs, stats[i].touch_secs,
+	       100.0*stats[i].touch_alloc_secs/stats[i].touch_secs,
+	       stats[i].secs);
+    }
+}
+
+/*
+ * printperf - prints the hardware event counts per request for each
+ *     trace, and the instructions per cycle
+ */
+static void printperf(int n, stats_t *stats)
+{
+    int i, e;
+
+    printf("\nHardware counters (per op):\n");
+    printf("%5s %6s", "trace", "Kops");
+    for (e = 0; e < PERF_NEVENTS; e++)
+	printf(" %9s", perf_event_name(e));
+    printf(" %5s\n", "IPC");
+    for (i = 0; i < n; i++) {
+	perf_counts_t *c = stats[i].perf;
+
+	if (!stats[i].valid || c == NULL)
+	    continue;
+	printf("%5d %6.0f", i, (stats[i].ops/1e3)/stats[i].secs);
+	for (e = 0; e < PERF_NEVENTS; e++) {
+	    if (c->valid[e])
+		printf(" %9.2f", c->count[e] / stats[i].ops);
+	    else
+		printf(" %9s", "-");
+	}
+	if (c->valid[PERF_INSTRUCTIONS] && c->valid[PERF_CYCLES] &&
+	    c->count[PERF_CYCLES] > 0)
+	    printf(" %5.2f\n",
+		   c->count[PERF_INSTRUCTIONS] / c->count[PERF_CYCLES]);
+	else
+	    printf(" %5s\n", "-");
+    }
+}
+
+/*
+ * printlatency - prints the latency percentiles (in ns) of each op type
+ *     and size class, followed by the op type over all sizes
+ */
+static void printlatency(int n, stats_t *stats)
+{
+    static const char *opnames[LAT_NOPS] = {"malloc", "free", "realloc"};
+    double tpns = lat_ticks_per_ns();
+    lat_hist_t all;
+    int i, op, sc;
+
+    printf("\nLatency (ns):\n");
+    printf("%5s %8s %6s %8s %8s %8s %8s %8s\n",
+	   "trace", "op", "size", "count", "p50", "p99", "p99.9", "max");
+    for (i = 0; i < n; i++) {
+	if (!stats[i].valid || stats[i].lat == NULL)
+	    continue;
+	for (op = 0; op < LAT_NOPS; op++) {
+	    for (sc = 0; sc <= LAT_NSIZES; sc++) {
+		const lat_hist_t *h;
+
+		if (sc < LAT_NSIZES) {
+		    h = &stats[i].lat->hist[op][sc];
+		} else {
+		    lat_merge(stats[i].lat, op, &all);
+		    h = &all;
+		}
+		if (h->count == 0)
+		    continue;
+		printf("%5d %8s %6s %8lu %8.0f %8.0f %8.0f %8.0f\n",
+		       i, opnames[op],
+		       (sc < LAT_NSIZES) ? lat_size_label(sc) : "all",
+		       (unsigned long)h->count,
+		       lat_percentile(h, 50.0) / tpns,
+		       lat_percentile(h, 99.0) / tpns,
+		       lat_percentile(h, 99.9) / tpns,
+		       h->max / tpns);
+	    }
+	}
+    }
+}
+
+/******************************************************************
+ * The following routines analyze the requests in a trace, without
+ * running any allocator, to guide the tuning of the size classes.
+ ******************************************************************/
+
+/* Lifetimes (in ops) are counted in decades: 1-9, 10-99, ... */
+#define LIFE_DECADES 6
+
+/* Number of points printed on the live-set curve */
+#define CURVE_POINTS 10
+
+/*
+ * analyze_trace - Report, for one trace, the request sizes mapped
+ *     onto mm.c's size classes and the internal fragmentation their
+ *     rounding implies, the object lifetimes, the live set over time,
+ *     and the realloc growth chains.
+ */
+static void analyze_trace(trace_t *trace, char *name)
+{
+    unsigned long count[MM_NCLASSES] = {0};
+    double req[MM_NCLASSES] = {0}, blk[MM_NCLASSES] = {0};
+    size_t lo[MM_NCLASSES], hi[MM_NCLASSES] = {0};
+    unsigned long life[LIFE_DECADES] = {0};
+    double curve[CURVE_POINTS];
+    unsigned *born, *reallocs, *sizes, *first;
+    unsigned i, id, lifetime;
+    size_t asize;
+    int c, d, point = 0;
+    double live = 0.0, live_blk = 0.0, peak = 0.0, peak_blk = 0.0;
+    double live_sum = 0.0, life_sum = 0.0, growth_sum = 0.0;
+    double req_total = 0.0, blk_total = 0.0;
+    unsigned long nlife = 0, chains = 0, chain_ops = 0, max_chain = 0;
+    unsigned long shrinks = 0, counts[3] = {0};
+
+    if ((born = calloc(trace->num_ids, sizeof(unsigned))) == NULL ||
+	(reallocs = calloc(trace->num_ids, sizeof(unsigned))) == NULL ||
+	(sizes = calloc(trace->num_ids, sizeof(unsigned))) == NULL ||
+	(first = calloc(trace->num_ids, sizeof(unsigned))) == NULL)
+	unix_error("calloc failed in analyze_trace");
+    for (c = 0; c < MM_NCLASSES; c++)
+	lo[c] = (size_t)-1;
+
+    for (i = 0; i < trace->num_ops; i++) {
+	id = trace->ops[i].index;
+	counts[trace->ops[i].type]++;
+	if (trace->ops[i].type == FREE) {
+	    lifetime = i - born[id];
+	    for (d = 0; d < LIFE_DECADES - 1 && lifetime >= 10; d++)
+		lifetime /= 10;
+	    life[d]++;
+	    life_sum += i - born[id];
+	    nlife++;
+	    if (reallocs[id] > 0 && first[id] > 0)
+		growth_sum += (double)sizes[id] / first[id];
+	    live -= sizes[id];
+	    live_blk -= get_size(sizes[id]);
+	    sizes[id] = 0;
+	} else {
+	    /* Class the request by the block size mm.c would use */
+	    asize = get_size(trace->ops[i].size);
+	    c = get_list_index(asize);
+	    count[c]++;
+	    req[c] += trace->ops[i].size;
+	    blk[c] += asize;
+	    if (asize < lo[c])
+		lo[c] = asize;
+	    if (asize > hi[c])
+		hi[c] = asize;
+	    req_total += trace->ops[i].size;
+	    blk_total += asize;
+
+	    if (trace->ops[i].type == ALLOC) {
+		born[id] = i;
+		first[id] = trace->ops[i].size;
+	    } else {
+		reallocs[id]++;
+		if ((unsigned)trace->ops[i].size < sizes[id])
+		    shrinks++;
+		live -= sizes[id];
+		live_blk -= get_size(sizes[id]);
+	    }
+	    sizes[id] = trace->ops[i].size;
+	    live += sizes[id];
+	    live_blk += asize;
+	    if (live > peak) {
+		peak = live;
+		peak_blk = live_blk;
+	    }
+	}
+	live_sum += live;
+	while (point < CURVE_POINTS && (unsigned long)(i + 1) * CURVE_POINTS >=
+	       (unsigned long)(point + 1) * trace->num_ops)
+	    curve[point++] = live;
+    }
+
+    for (id = 0; id < trace->num_ids; id++) {
+	if (reallocs[id] == 0)
+	    continue;
+	chains++;
+	chain_ops += reallocs[id];
+	if (reallocs[id] > max_chain)
+	    max_chain = reallocs[id];
+	if (sizes[id] > 0 && first[id] > 0) /* never freed */
+	    growth_sum += (double)sizes[id] / first[id];
+    }
+
+    printf("\nAnalysis of %s: %u ids, %lu allocs, %lu frees, %lu reallocs\n",
+	   name, trace->num_ids, counts[ALLOC], counts[FREE], counts[REALLOC]);
+
+    printf("class  block sizes      requests   avg req   avg blk  int frag\n");
+    for (c = 0; c < MM_NCLASSES; c++) {
+	if (count[c] == 0)
+	    continue;
+	printf("%5d  %6lu-%-8lu %8lu %9.0f %9.0f %8.1f%%\n", c,
+	       (unsigned long)lo[c], (unsigned long)hi[c], count[c],
+	       req[c] / count[c], blk[c] / count[c],
+	       100.0 * (1.0 - req[c] / blk[c]));
+    }
+    if (blk_total > 0.0)
+	printf("Total                   %8lu %9.0f %9.0f %8.1f%%\n",
+	       counts[ALLOC] + counts[REALLOC],
+	       req_total / (counts[ALLOC] + counts[REALLOC]),
+	       blk_total / (counts[ALLOC] + counts[REALLOC]),
+	       100.0 * (1.0 - req_total / blk_total));
+
+    printf("Lifetimes (ops):");
+    for (d = 0, lifetime = 1; d < LIFE_DECADES; d++, lifetime *= 10)
+	printf(" %s%u:%lu", (d == LIFE_DECADES - 1) ? ">=" : "<",
+	       (d == LIFE_DECADES - 1) ? lifetime : lifetime * 10, life[d]);
+    printf("  mean %.0f\n", nlife ? life_sum / nlife : 0.0);
+
+    printf("Live bytes: peak %.0f (%.0f in blocks, %.1f%% int frag), "
+	   "average %.0f\n", peak, peak_blk,
+	   peak_blk > 0.0 ? 100.0 * (1.0 - peak / peak_blk) : 0.0,
+	   trace->num_ops ? live_sum / trace->num_ops : 0.0);
+    if (trace->num_ops >= CURVE_POINTS && peak > 0.0) {
+	printf("Live-set curve (%% of peak, every %u%% of the ops):",
+	       100 / CURVE_POINTS);
+	for (d = 0; d < CURVE_POINTS; d++)
+	    printf(" %.0f", 100.0 * curve[d] / peak);
+	printf("\n");
+    }
+
+    if (chains > 0)
+	printf("Realloc chains: %lu, mean length %.1f, longest %lu, "
+	       "mean growth %.1fx, %lu shrinks\n", chains,
+	       (double)chain_ops / chains, max_chain, growth_sum / chains,
+	       shrinks);
+
+    free(born);
+    free(reallocs);
+    free(sizes);
+    free(first);
+}
+
+/*
+ * write_timeline - Write the heap samples of every trace as CSV, one
+ *     row per sample. ext_frag is the fraction of free bytes outside
+ *     the largest free block.
+ */
+static void write_timeline(char *filename, char **tracefiles, int n,
+			   stats_t *mm_stats)
+{
+    FILE *fp;
+    int i, k, c;
+
+    if ((fp = fopen(filename, "w")) == NULL)
+	unix_error("fopen failed in write_timeline");
+    fprintf(fp, "trace,file,op,live_bytes,heap_bytes,free_bytes,"
+	    "largest_free,ext_frag");
+    for (c = 0; c < MM_NCLASSES; c++)
+	fprintf(fp, ",free_class%d", c);
+    fprintf(fp, "\n");
+
+    for (i = 0; i < n; i++) {
+	timeline_t *tl = mm_stats[i].timeline;
+
+	if (!mm_stats[i].valid || tl == NULL)
+	    continue;
+	for (k = 0; k < tl->n; k++) {
+	    sample_t *s = &tl->sample[k];
+
+	    fprintf(fp, "%d,", i);
+	    csv_string(fp, tracefiles[i]);
+	    fprintf(fp, ",%u,%.0f,%.0f,%.0f,%.0f,%.4f",
+		    s->op, s->live, s->heap, s->free, s->largest,
+		    (s->free > 0.0) ? 1.0 - s->largest / s->free : 0.0);
+	    for (c = 0; c < MM_NCLASSES; c++)
+		fprintf(fp, ",%.0f", s->class_free[c]);
+	    fprintf(fp, "\n");
+	}
+    }
+    fclose(fp);
+}
+
+/******************************************************************
+ * The following routines export the results in a machine-readable
+ * form (JSON or CSV) and compare a run against a stored CSV baseline.
+ ******************************************************************/
+
+/*
+ * result_fields - Fill in the names and values of the metrics for one
+ *     trace. Values that were not measured are NAN. Returns the number
+ *     of fields.
+ */
+static int result_fields(stats_t *stats, const char **names, double *vals)
+{
+    static const char *latnames[LAT_NOPS][4] = {
+	{"malloc_p50_ns", "malloc_p99_ns", "malloc_p999_ns", "malloc_max_ns"},
+	{"free_p50_ns", "free_p99_ns", "free_p999_ns", "free_max_ns"},
+	{"realloc_p50_ns", "realloc_p99_ns", "realloc_p999_ns",
+	 "realloc_max_ns"}
+    };
+    static const char *perfnames[PERF_NEVENTS] = {
+	"instr_per_op", "cycles_per_op", "l1d_miss_per_op",
+	"llc_miss_per_op", "dtlb_miss_per_op", "branch_miss_per_op"
+    };
+    int n = 0, op;
+    lat_hist_t all;
+    double tpns;
+
+    names[n] = "util";
+    vals[n++] = stats->valid ? stats->util : NAN;
+    names[n] = "ops";
+    vals[n++] = stats->ops;
+    names[n] = "secs";
+    vals[n++] = stats->valid ? stats->secs : NAN;
+    names[n] = "secs_lo";
+    vals[n++] = stats->valid ? stats->secs_lo : NAN;
+    names[n] = "secs_hi";
+    vals[n++] = stats->valid ? stats->secs_hi : NAN;
+    names[n] = "kops";
+    vals[n++] = stats->valid ? (stats->ops/1e3)/stats->secs : NAN;
+    names[n] = "heap_bytes";
+    vals[n++] = (stats->valid && stats->heap > 0) ? stats->heap : NAN;
+    names[n] = "sbrk_calls";
+    vals[n++] = (stats->valid && stats->sbrks > 0) ? stats->sbrks : NAN;
+
+    names[n] = "touch_secs";
+    vals[n++] = (stats->valid && stats->touch_secs > 0) ?
+	stats->touch_secs : NAN;
+    names[n] = "touch_alloc_secs";
+    vals[n++] = (stats->valid && stats->touch_secs > 0) ?
+	stats->touch_alloc_secs : NAN;
+
+    names[n] = "steady_kops_drift";
+    vals[n++] = (stats->valid && stats->steady != NULL &&
+		 stats->steady->iters > 0) ?
+	stats->steady->iter[0].secs /
+	stats->steady->iter[stats->steady->iters - 1].secs - 1.0 : NAN;
+    names[n] = "steady_util_last";
+    vals[n++] = (stats->valid && stats->steady != NULL &&
+		 stats->steady->iters > 0) ?
+	stats->steady->iter[stats->steady->iters - 1].util : NAN;
+
+    tpns = (stats->lat != NULL) ? lat_ticks_per_ns() : 0.0;
+    for (op = 0; op < LAT_NOPS; op++) {
+	int have = 0;
+
+	if (stats->lat != NULL) {
+	    lat_merge(stats->lat, op, &all);
+	    have = (all.count > 0);
+	}
+	names[n] = latnames[op][0];
+	vals[n++] = have ? lat_percentile(&all, 50.0) / tpns : NAN;
+	names[n] = latnames[op][1];
+	vals[n++] = have ? lat_percentile(&all, 99.0) / tpns : NAN;
+	names[n] = latnames[op][2];
+	vals[n++] = have ? lat_percentile(&all, 99.9) / tpns : NAN;
+	names[n] = latnames[op][3];
+	vals[n++] = have ? all.max / tpns : NAN;
+    }
+
+    for (op = 0; op < PERF_NEVENTS; op++) {
+	names[n] = perfnames[op];
+	vals[n++] = (stats->valid && stats->perf != NULL &&
+		     stats->perf->valid[op]) ?
+	    stats->perf->count[op] / stats->ops : NAN;
+    }
+    assert(n <= MAXFIELDS);
+    return n;
+}
+
+/*
+ * write_results - Write the per-trace results of both packages to
+ *     filename, as JSON if its name ends in ".json" and as CSV otherwise.
+ *     The CSV form can be read back by compare_baseline.
+ */
+static void write_results(char *filename, char **tracefiles, int n,
+			  stats_t **pkgstats, double perfindex)
+{
+    const char *names[MAXFIELDS];
+    double vals[MAXFIELDS];
+    size_t len = strlen(filename);
+    int json = (len >= 5 && strcmp(filename + len - 5, ".json") == 0);
+    int first = 1;
+    int pkg, i, f, nfields;
+    FILE *fp;
+
+    if ((fp = fopen(filename, "w")) == NULL) {
+	sprintf(msg, "Could not open %s in write_results", filename);
+	unix_error(msg);
+    }
+
+    if (json)
+	fprintf(fp, "{\n  \"perfindex\": %.0f,\n  \"results\": [", perfindex);
+    for (pkg = 0; pkg < num_backends; pkg++) {
+	for (i = 0; i < n; i++) {
+	    nfields = result_fields(&pkgstats[pkg][i], names, vals);
+	    if (json) {
+		fprintf(fp, "%s\n    {\"package\": ", first ? "" : ",");
+		json_string(fp, backends[pkg].name);
+		fprintf(fp, ", \"trace\": %d, \"file\": ", i);
+		json_string(fp, tracefiles[i]);
+		fprintf(fp, ", \"valid\": %s",
+			pkgstats[pkg][i].valid ? "true" : "false");
+		for (f = 0; f < nfields; f++) {
+		    fprintf(fp, ", ");
+		    json_string(fp, names[f]);
+		    if (isnan(vals[f]))
+			fprintf(fp, ": null");
+		    else
+			fprintf(fp, ": %.9g", vals[f]);
+		}
+		fprintf(fp, "}");
+	    } else {
+		if (first) {
+		    fprintf(fp, "package,trace,file,valid");
+		    for (f = 0; f < nfields; f++)
+			fprintf(fp, ",%s", names[f]);
+		    fprintf(fp, "\n");
+		}
+		csv_string(fp, backends[pkg].name);
+		fprintf(fp, ",%d,", i);
+		csv_string(fp, tracefiles[i]);
+		fprintf(fp, ",%d", pkgstats[pkg][i].valid);
+		for (f = 0; f < nfields; f++) {
+		    if (isnan(vals[f]))
+			fprintf(fp, ",");
+		    else
+			fprintf(fp, ",%.9g", vals[f]);
+		}
+		fprintf(fp, "\n");
+	    }
+	    first = 0;
+	}
+    }
+    if (json)
+	fprintf(fp, "\n  ]\n}\n");
+    fclose(fp);
+}
+
+/*
+ * t_crit - One-sided 95% critical value of Student's t distribution
+ *     with df degrees of freedom
+ */
+static double t_crit(int df)
+{
+    static const double table[] = {
+	0.0, 6.314, 2.920, 2.353, 2.132, 2.015, 1.943, 1.895, 1.860,
+	1.833, 1.812, 1.796, 1.782, 1.771, 1.761, 1.753, 1.746, 1.740,
+	1.734, 1.729, 1.725, 1.721, 1.717, 1.714, 1.711, 1.708, 1.706,
+	1.703, 1.701, 1.699, 1.697
+    };
+
+    if (df < (int)(sizeof(table) / sizeof(table[0])))
+	return table[df];
+    return 1.645;
+}
+
+/*
+ * csv_string - Write s as a CSV field, in double quotes, with each
+ *     double quote in it doubled
+ */
+static void csv_string(FILE *fp, const char *s)
+{
+    putc('"', fp);
+    for (; *s != '\0'; s++) {
+	if (*s == '"')
+	    putc('"', fp);
+	putc(*s, fp);
+    }
+    putc('"', fp);
+}
+
+/*
+ * json_string - Write s as a JSON string, escaping double quotes,
+ *     backslashes and control characters
+ */
+static void json_string(FILE *fp, const char *s)
+{
+    putc('"', fp);
+    for (; *s != '\0'; s++) {
+	if (*s == '"' || *s == '\\')
+	    fprintf(fp, "\\%c", *s);
+	else if ((unsigned char)*s < 0x20)
+	    fprintf(fp, "\\u%04x", (unsigned char)*s);
+	else
+	    putc(*s, fp);
+    }
+    putc('"', fp);
+}
+
+/*
+ * csv_field - Copy the col-th comma-separated field of line into buf,
+ *     undoing the quoting of csv_string
+ */
+static void csv_field(char *line, int col, char *buf)
+{
+    char *p = line;
+    int quoted = 0;
+
+    /* Skip col fields, minding the commas inside quotes */
+    for (; col > 0 && *p != '\0'; p++) {
+	if (*p == '"')
+	    quoted = !quoted;
+	else if (*p == ',' && !quoted)
+	    col--;
+    }
+    for (quoted = 0; col == 0 && *p != '\0'; p++) {
+	if (*p == '"' && quoted && p[1] == '"')
+	    *buf++ = *++p;
+	else if (*p == '"')
+	    quoted = !quoted;
+	else if (!quoted && (*p == ',' || *p == '\r' || *p == '\n'))
+	    break;
+	else
+	    *buf++ = *p;
+    }
+    *buf = '\0';
+}
+
+/*
+ * compare_baseline - Compare the mm results against the mm records of
+ *     a CSV file written by write_results. Traces are matched by file
+ *     name. Throughput is compared through the per-trace log ratios of
+ *     Kops: their mean must drop by more than REGRESS_THRUPUT, and a
+ *     one-sided t-test over the traces must find the drop significant.
+ *     With a single trace, the threshold alone decides. A trace that
+ *     was valid in the baseline and fails now is a regression. Returns
+ *     1 if the run regressed or had no valid traces in common with the
+ *     baseline, and 0 otherwise.
+ */
+static int compare_baseline(char *filename, char **tracefiles, int n,
+			    stats_t *mm_stats)
+{
+    FILE *fp;
+    char line[MAXLINE], field[MAXLINE];
+    int col_pkg = -1, col_file = -1, col_valid = -1, col_util = -1;
+    int col_kops = -1;
+    int col, i, common = 0, matched = 0, regressed = 0;
+    double sum = 0.0, sumsq = 0.0;
+
+    if ((fp = fopen(filename, "r")) == NULL) {
+	sprintf(msg, "Could not open %s in compare_baseline", filename);
+	unix_error(msg);
+    }
+
+    /* Locate the columns we need in the header line */
+    if (fgets(line, MAXLINE, fp) == NULL)
+	app_error("Empty baseline file");
+    for (col = 0; csv_field(line, col, field), field[0] != '\0'; col++) {
+	if (!strcmp(field, "package"))
+	    col_pkg = col;
+	else if (!strcmp(field, "file"))
+	    col_file = col;
+	else if (!strcmp(field, "valid"))
+	    col_valid = col;
+	else if (!strcmp(field, "util"))
+	    col_util = col;
+	else if (!strcmp(field, "kops"))
+	    col_kops = col;
+    }
+    if (col_pkg < 0 || col_file < 0 || col_valid < 0 || col_util < 0 ||
+	col_kops < 0)
+	app_error("Baseline file is not a CSV file written by mdriver -o");
+
+    printf("\nComparison against baseline %s:\n", filename);
+    printf("%5s %8s %8s %8s %8s\n", "trace", "util", "base", "Kops", "base");
+    while (fgets(line, MAXLINE, fp) != NULL) {
+	double base_util, base_kops, kops, r;
+
+	csv_field(line, col_pkg, field);
+	if (strcmp(field, "mm") != 0)
+	    continue;
+	csv_field(line, col_valid, field);
+	if (atoi(field) == 0)
+	    continue;
+	csv_field(line, col_file, field);
+	for (i = 0; i < n; i++)
+	    if (!strcmp(field, tracefiles[i]))
+		break;
+	if (i == n)
+	    continue;
+	common++;
+	if (!mm_stats[i].valid) {
+	    printf("Regression: trace %d was valid in the baseline, but "
+		   "failed now\n", i);
+	    regressed = 1;
+	    continue;
+	}
+
+	csv_field(line, col_util, field);
+	base_util = atof(field);
+	csv_field(line, col_kops, field);
+	base_kops = atof(field);
+	kops = (mm_stats[i].ops/1e3)/mm_stats[i].secs;
+	printf("%5d %7.1f%% %7.1f%% %8.0f %8.0f\n", i,
+	       mm_stats[i].util*100.0, base_util*100.0, kops, base_kops);
+
+	if (mm_stats[i].util < base_util - REGRESS_UTIL) {
+	    printf("Regression: trace %d utilization dropped from "
+		   "%.1f%% to %.1f%%\n",
+		   i, base_util*100.0, mm_stats[i].util*100.0);
+	    regressed = 1;
+	}
+	r = log(kops / base_kops);
+	sum += r;
+	sumsq += r * r;
+	matched++;
+    }
+    fclose(fp);
+
+    /* A run with nothing to compare against does not pass */
+    if (matched == 0) {
+	if (common == 0)
+	    printf("No traces in common with the baseline\n");
+	return 1;
+    }
+
+    /* Test the mean throughput change over the matched traces */
+    {
+	double mean = sum / matched;
+	double change = exp(mean) - 1.0;
+	int significant = 1;
+
+	if (matched > 1) {
+	    double var = (sumsq - matched * mean * mean) / (matched - 1);
+	    double se = sqrt(var > 0.0 ? var / matched : 0.0);
+
+	    significant = (se == 0.0) || (mean / se < -t_crit(matched - 1));
+	}
+	printf("Throughput change: %+.1f%% (geometric mean of %d traces)\n",
+	       change*100.0, matched);
+	if (change < -REGRESS_THRUPUT && significant) {
+	    printf("Regression: throughput dropped by %.1f%%\n",
+		   -change*100.0);
+	    regressed = 1;
+	}
+    }
+    return regressed;
 }
 
 /* 
@@ -1013,14 +3137,57 @@ void malloc_error(int tracenum, int opnum, char *msg)
  */
 static void usage(void) 
 {
-    fprintf(stderr, "Usage: mdriver [-hvVal] [-f <file>] [-t <dir>]\n");
+    fprintf(stderr, "Usage: mdriver [-hvValAHPR] [-f <file>] [-t <dir>] [-B <lib>] "
+	    "[-o <file>] [-b <file>] [-T <frac>]\n"
+	    "               [-s <n>] [-r <n>] [-w <n>] [-W <n>] [-j <n>]\n"
+	    "               [-u <n>] [-U <file>] [-E <prefix>] [-c <n>]\n"
+	    "               [-G <min>:<max>:<pct>:<window>] "
+	    "[-L fifo|lifo|addr] [-K <k>]\n");
     fprintf(stderr, "Options\n");
     fprintf(stderr, "\t-a         Don't check the team structure.\n");
+    fprintf(stderr, "\t-A         Analyze the traces' sizes, lifetimes and "
+	    "live set only.\n");
+    fprintf(stderr, "\t-b <file>  Compare against a baseline CSV file; "
+	    "exit 2 on regression.\n");
+    fprintf(stderr, "\t-B <lib>   Also run the allocator in shared library "
+	    "<lib>[:<prefix>].\n");
+    fprintf(stderr, "\t-c <n>     Check the blocks each op touches, and "
+	    "the whole mm heap every <n> ops.\n");
+    fprintf(stderr, "\t-E <pre>   Log mm's decisions on trace i to "
+	    "<pre>i.evl (make EVLOG=1).\n");
     fprintf(stderr, "\t-f <file>  Use <file> as the trace file.\n");
     fprintf(stderr, "\t-g         Generate summary info for autograder.\n");
+    fprintf(stderr, "\t-G <pol>   Grow the mm heap by <min>:<max>:<pct>:"
+	    "<window> (see mm.h);\n"
+	    "\t           <min> is at most the heap size, %d bytes.\n",
+	    MAX_HEAP);
     fprintf(stderr, "\t-h         Print this message.\n");
+    fprintf(stderr, "\t-H         Record per-op latency histograms.\n");
+    fprintf(stderr, "\t-j <n>     Evaluate traces in <n> worker processes, "
+	    "one per CPU.\n");
+    fprintf(stderr, "\t-K <k>     Place mm blocks in the best of <k> fits "
+	    "(default 1, first fit).\n");
     fprintf(stderr, "\t-l         Run libc malloc as well.\n");
+    fprintf(stderr, "\t-L <ord>   Keep the mm free lists in fifo (default), "
+	    "lifo or addr order.\n");
+    fprintf(stderr, "\t-o <file>  Write per-trace results as JSON "
+	    "(*.json) or CSV.\n");
+    fprintf(stderr, "\t-P         Read hardware performance counters.\n");
+    fprintf(stderr, "\t-r <n>     Time each trace with <n> repetitions.\n");
+    fprintf(stderr, "\t-R         Carve large mm blocks from a heap region "
+	    "of their own.\n");
+    fprintf(stderr, "\t-s <n>     Measure util in the validity pass, checking "
+	    "overlaps every <n> ops.\n");
     fprintf(stderr, "\t-t <dir>   Directory to find default traces.\n");
+    fprintf(stderr, "\t-T <frac>  Also time a replay that touches <frac> "
+	    "of each payload.\n");
+    fprintf(stderr, "\t-u <n>     Sample the mm heap every <n> ops.\n");
+    fprintf(stderr, "\t-U <file>  Write the heap samples to <file> "
+	    "(default timeline.csv).\n");
     fprintf(stderr, "\t-v         Print per-trace performance breakdowns.\n");
+    fprintf(stderr, "\t-w <n>     Also replay each trace <n> times on one "
+	    "warm heap.\n");
+    fprintf(stderr, "\t-W <n>     Age the warm heap with <n> blocks, half "
+	    "left allocated.\n");
     fprintf(stderr, "\t-V         Print additional debug info.\n");
 }
@@ -16,7 +16,8 @@
 
 /* private variables */
 static char *mem_start_brk;  /* points to first byte of heap */
-static char *mem_brk;        /* points to last byte of heap */
+static char *mem_brk;        /* points to last byte of region 0 */
+static char *mem_top_brk;    /* points to first byte of region 1 */
 static char *mem_max_addr;   /* largest legal heap address */ 
 
 /* 
@@ -32,6 +33,7 @@ void mem_init(void)
 
     mem_max_addr = mem_start_brk + MAX_HEAP;  /* max legal heap address */
     mem_brk = mem_start_brk;                  /* heap is empty initially */
+    mem_top_brk = mem_max_addr;
 }
 
 /* 
@@ -48,6 +50,7 @@ void mem_deinit(void)
 void mem_reset_brk()
 {
     mem_brk = mem_start_brk;
+    mem_top_brk = mem_max_addr;
 }
 
 /* 
@@ -56,14 +59,26 @@ void mem_reset_brk()
  *    this model, the heap cannot be shrunk.
  */
 void *mem_sbrk(intptr_t incr) 
+{
+    return mem_sbrk_region(0, incr);
+}
+
+/*
+ * mem_sbrk_region - mem_sbrk for one region of the heap. Region 0 grows
+ *    up from the start of the heap and region 1 down from its end, so
+ *    the start address of region 1's new area is its new first byte.
+ */
+void *mem_sbrk_region(int region, intptr_t incr)
 {
     char *old_brk = mem_brk;
 
-    if ( (incr < 0) || ((mem_brk + incr) > mem_max_addr)) {
+    if ( (incr < 0) || (incr > mem_top_brk - mem_brk)) {
 	errno = ENOMEM;
 	fprintf(stderr, "ERROR: mem_sbrk failed. Ran out of memory...\n");
 	return (void *)-1;
     }
+    if (region == 1)
+	return (void *)(mem_top_brk -= incr);
     mem_brk += incr;
     return (void *)old_brk;
 }
@@ -81,15 +96,41 @@ void *mem_heap_lo()
  */
 void *mem_heap_hi()
 {
+    /* Region 1, if it is in use, or else region 0 */
+    if (mem_top_brk < mem_max_addr)
+	return (void *)(mem_max_addr - 1);
     return (void *)(mem_brk - 1);
 }
 
+/*
+ * mem_region_lo, mem_region_hi - return the addresses of the first and
+ *    last bytes of a region
+ */
+void *mem_region_lo(int region)
+{
+    return (void *)((region == 1) ? mem_top_brk : mem_start_brk);
+}
+
+void *mem_region_hi(int region)
+{
+    return (void *)((region == 1) ? mem_max_addr - 1 : mem_brk - 1);
+}
+
 /*
  * mem_heapsize() - returns the heap size in bytes
  */
 size_t mem_heapsize() 
 {
-    return (size_t)(mem_brk - mem_start_brk);
+    return (size_t)((mem_brk - mem_start_brk) + (mem_max_addr - mem_top_brk));
+}
+
+/*
+ * mem_heaproom() - returns how many more bytes the heap can grow by,
+ *    in either region
+ */
+size_t mem_heaproom() 
+{
+    return (size_t)(mem_top_brk - mem_brk);
 }
 
 /*
@@ -1,8 +1,21 @@
 void mem_init(void);               
 void mem_deinit(void);
 void *mem_sbrk(intptr_t incr);
+
+/*
+ * The heap is MEM_NREGIONS regions that share its space: region 0 grows
+ * up from its start, and region 1 down from its end, so that a region
+ * that is not used costs nothing.  mem_sbrk grows region 0.  mem_heap_lo
+ * and mem_heap_hi bound both of them, and mem_heapsize is their total
+ * size.
+ */
+#define MEM_NREGIONS 2
+void *mem_sbrk_region(int region, intptr_t incr);
+void *mem_region_lo(int region);
+void *mem_region_hi(int region);
 void mem_reset_brk(void); 
 void *mem_heap_lo(void);
 void *mem_heap_hi(void);
 size_t mem_heapsize(void);
+size_t mem_heaproom(void);
 size_t mem_pagesize(void);
@@ -0,0 +1,158 @@
+/*
+ * memlib_mmap.c - a version of memlib.c that backs the heap with real
+ *            virtual memory, for building mm.c as a malloc replacement
+ *            (libmm.so). It reserves one large region of address space
+ *            up front, without committing swap for it, so mem_sbrk can
+ *            hand out contiguous memory just as the simulated model does.
+ *            Pages are only backed when they are first touched.
+ *
+ *            Unlike memlib.c, nothing here may call malloc or stdio,
+ *            since this code runs underneath them.
+ */
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "memlib.h"
+
+/* Largest reservation to try, and the smallest to settle for */
+#define MMAP_HEAP     ((size_t)1 << 38)  /* 256 GB */
+#define MIN_MMAP_HEAP ((size_t)1 << 30)  /* 1 GB */
+
+/* private variables */
+static char *mem_start_brk;  /* points to first byte of heap */
+static char *mem_brk;        /* points to last byte of region 0 */
+static char *mem_top_brk;    /* points to first byte of region 1 */
+static char *mem_max_addr;   /* largest legal heap address */
+
+/*
+ * mem_init - reserve the address space for the heap. If the kernel
+ *    refuses a reservation (e.g., under strict overcommit), try again
+ *    with half as much.
+ */
+void mem_init(void)
+{
+    size_t size;
+    void *p = MAP_FAILED;
+
+    for (size = MMAP_HEAP; size >= MIN_MMAP_HEAP; size /= 2) {
+	p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (p != MAP_FAILED)
+	    break;
+    }
+    if (p == MAP_FAILED)
+	size = 0;    /* Leave the heap empty, so that every mem_sbrk fails */
+
+    mem_start_brk = (size > 0) ? (char *)p : NULL;
+    mem_max_addr = mem_start_brk + size;      /* max legal heap address */
+    mem_brk = mem_start_brk;                  /* heap is empty initially */
+    mem_top_brk = mem_max_addr;
+}
+
+/*
+ * mem_deinit - release the address space used by the heap
+ */
+void mem_deinit(void)
+{
+    if (mem_start_brk != NULL)
+	munmap(mem_start_brk, mem_max_addr - mem_start_brk);
+    mem_start_brk = mem_brk = mem_top_brk = mem_max_addr = NULL;
+}
+
+/*
+ * mem_reset_brk - reset the brk pointer to make an empty heap
+ */
+void mem_reset_brk()
+{
+    mem_brk = mem_start_brk;
+    mem_top_brk = mem_max_addr;
+}
+
+/*
+ * mem_sbrk - extends the heap by incr bytes and returns the start
+ *    address of the new area. The heap cannot be shrunk.
+ */
+void *mem_sbrk(intptr_t incr)
+{
+    return mem_sbrk_region(0, incr);
+}
+
+/*
+ * mem_sbrk_region - mem_sbrk for one region of the heap. Region 0 grows
+ *    up from the start of the reservation and region 1 down from its
+ *    end, so the start address of region 1's new area is its new first
+ *    byte.
+ */
+void *mem_sbrk_region(int region, intptr_t incr)
+{
+    char *old_brk = mem_brk;
+
+    if ((incr < 0) || (size_t)incr > (size_t)(mem_top_brk - mem_brk)) {
+	errno = ENOMEM;
+	return (void *)-1;
+    }
+    if (region == 1)
+	return (void *)(mem_top_brk -= incr);
+    mem_brk += incr;
+    return (void *)old_brk;
+}
+
+/*
+ * mem_heap_lo - return address of the first heap byte
+ */
+void *mem_heap_lo()
+{
+    return (void *)mem_start_brk;
+}
+
+/*
+ * mem_heap_hi - return address of last heap byte
+ */
+void *mem_heap_hi()
+{
+    /* Region 1, if it is in use, or else region 0 */
+    if (mem_top_brk < mem_max_addr)
+	return (void *)(mem_max_addr - 1);
+    return (void *)(mem_brk - 1);
+}
+
+/*
+ * mem_region_lo, mem_region_hi - return the addresses of the first and
+ *    last bytes of a region
+ */
+void *mem_region_lo(int region)
+{
+    return (void *)((region == 1) ? mem_top_brk : mem_start_brk);
+}
+
+void *mem_region_hi(int region)
+{
+    return (void *)((region == 1) ? mem_max_addr - 1 : mem_brk - 1);
+}
+
+/*
+ * mem_heapsize() - returns the heap size in bytes
+ */
+size_t mem_heapsize()
+{
+    return (size_t)((mem_brk - mem_start_brk) + (mem_max_addr - mem_top_brk));
+}
+
+/*
+ * mem_heaproom() - returns how many more bytes the heap can grow by,
+ *    in either region
+ */
+size_t mem_heaproom()
+{
+    return (size_t)(mem_top_brk - mem_brk);
+}
+
+/*
+ * mem_pagesize() - returns the page size of the system
+ */
+size_t mem_pagesize()
+{
+    return (size_t)getpagesize();
+}
@@ -41,7 +41,8 @@ team_t team = {
 /* Basic constants and macros: */
 #define WSIZE      sizeof(void *) /* Word and header/footer size (bytes) */
 #define DSIZE      (2 * WSIZE)    /* Doubleword size (bytes) */
-#define CHUNKSIZE  4112      /* Extend heap by this amount (bytes) */
+#define CHUNKSIZE  4112      /* Extend heap by at least this amount (bytes) */
+#define GROWTH_DEFAULT  {CHUNKSIZE, 1 << 20, 12, 64} /* See mm_growth_t. */
 // #define COALESCE_THRESHOLD  8223
 
 #define MAX(x, y)  ((x) > (y) ? (x) : (y))  
@@ -85,28 +86,156 @@ team_t team = {
 #define NEXT_BLKP(bp)  ((char *)(bp) + GET_SIZE(HDRP(bp)))
 #define PREV_BLKP(bp)  ((char *)(bp) - GET_SIZE(HDRP(bp) - WSIZE))
 
-#define SEGLISTCOUNT 19
+#define SEGLISTCOUNT MM_NCLASSES
 /* Global variables: */
 static char *heap_listp; /* Pointer to first block */  
 
 /* Function prototypes for internal helper routines: */
 static void *coalesce(void *bp);
-static void *extend_heap(size_t words);
-static void *re_extend_heap(size_t words);
+static size_t grow_size(size_t need);
+static void *grow_region(int region, size_t *sizep);
+static void *extend_top(int region, size_t need);
+static void *take_bottom(void *p, size_t asize);
+static void set_top(void *p, size_t size, int prev_alloc);
+static void *take_top(void *p, size_t asize);
+static void free_to_top(void *p);
+static void *release_block(void *p);
+static bool drain_fastbins(void);
+static int find_finger(int index, void *p);
+static void add_finger(int index, int i, void *p);
 static void *find_fit(size_t asize);
+static size_t align_lead(void *p, size_t alignment);
+static void *find_aligned_fit(size_t alignment, size_t asize);
+static void *search_list(int index, size_t asize, int region);
 static void *place(void *bp, size_t asize);
 
 /* Function prototypes for heap consistency checker routines: */
 static void checkblock(void *bp);
 static void checkheap(bool verbose);
 static void printblock(void *bp); 
+static char *region_end(int region);
+static bool valid_header(void *p);
+static int check_free_block(void *p);
+static int check_around(void *p);
 void insert_free_block(void* p);
 void remove_free_block(void* p, int index);
-int get_list_index(size_t size);
-size_t get_size(size_t size);
 
 
-static uintptr_t **freelists;
+/*
+ * The heap regions: whether mm_init sets up a second one, and the number
+ * in use.  With two, blocks of at least LARGE_SIZE bytes come from region
+ * 1 and smaller ones from region 0, so that a long-lived small block
+ * cannot pin two large free blocks apart.  Each region has an epilogue
+ * and free lists of its own, and blocks only coalesce within a region.
+ * Region 0 grows up from the start of the heap, behind a prologue, and
+ * region 1 grows down from its end, so each extension of region 1 is a
+ * free block in front of its first block, and it has no top block.
+ */
+#define NREGIONS	MEM_NREGIONS
+#define LARGE_SIZE	(65 * DSIZE)	/* The smallest size in class 7. */
+#define REGION_OF(p)	(nregions > 1 && (char *)(p) >= first_block[1])
+static int regions_policy = 0;
+static int nregions;
+static char *first_block[NREGIONS];	/* first_block[0] is heap_listp. */
+
+/*
+ * The top blocks: the free block that ends each region, or NULL if its
+ * last block is allocated.  A top block is kept out of the free lists, so
+ * that it is only carved up when no listed block fits, and it grows in
+ * place when its region is extended.
+ */
+static void *top[NREGIONS];
+
+/* The heads of each region's free lists, which lie in its first words, or
+   for region 1 in its last words, after its epilogue. */
+static uintptr_t **freelists[NREGIONS];
+
+/*
+ * The heap growth policy that mm_init adopts, and its state: the current
+ * extension size, and the ops since mm_init as of now and as of the last
+ * extension.
+ */
+static mm_growth_t growth = GROWTH_DEFAULT;
+static size_t chunk;
+static size_t ops, extend_ops;
+
+/*
+ * The fast bins: LIFO lists of freed blocks of the exact sizes of classes
+ * 0 through NFASTBINS - 1, linked through their first payload word.  A
+ * block in a fast bin still looks allocated to its neighbors, so freeing
+ * it there and reusing it skip the boundary tags, coalescing and the free
+ * lists.  mm_malloc drains the fast bins before it grows the heap.
+ */
+#define NFASTBINS	6
+static void *fastbins[NFASTBINS];
+
+/*
+ * The order of the free lists: the MM_LIST_* policy that mm_init adopts,
+ * and the one in force.  Under MM_LIST_ADDRESS, each class also keeps an
+ * index of fingers, i.e., blocks on its list sorted by address, so that
+ * an insertion walks the list from the closest finger below the block
+ * rather than from the head.  A walk of more than FINGER_GAP blocks adds
+ * the inserted block as a finger; when the index is full, every other
+ * finger is dropped.
+ */
+#define NFINGERS	1024
+#define FINGER_GAP	4
+static int list_policy = MM_LIST_FIFO;
+static int list_order;
+static void *fingers[NREGIONS][SEGLISTCOUNT][NFINGERS];
+static int nfingers[NREGIONS][SEGLISTCOUNT];
+
+/* The blocks that fit that find_fit looks at before it picks one. */
+static unsigned int fit_search = 1;
+
+/* The counters reported by mm_get_stats. */
+static mm_stats_t counters;
+
+/*
+ * The headers of the blocks that the current op left behind, for
+ * mm_check_op.  No op touches more than NTOUCHED blocks, counting those
+ * of the ops it makes itself.
+ */
+#define NTOUCHED	4
+static void *touched[NTOUCHED];
+static unsigned int ntouched;
+#define TOUCH(header)	(touched[ntouched++ % NTOUCHED] = (header))
+
+/*
+ * The hot-path probes reported by mm_get_probes.  PROBE(counter++) costs
+ * nothing unless MM_PROBES is defined.
+ */
+#ifdef MM_PROBES
+static mm_probes_t probes;
+#define PROBE(expr)	((void)(probes.expr))
+#else
+#define PROBE(expr)	((void)0)
+#endif
+
+/*
+ * The event log written by mm_evlog_attach and mm_evlog_flush.
+ * EVLOG(type, header, size, aux) records an event and costs nothing
+ * unless MM_EVLOG is defined.  Ops that mm.c makes on its own behalf,
+ * e.g., mm_realloc's call to mm_malloc, are bracketed by EVLOG_NEST(1)
+ * and EVLOG_NEST(-1) so they do not count as ops.
+ */
+#ifdef MM_EVLOG
+#include <unistd.h>
+
+static mm_event_t evlog[MM_EVLOG_SIZE];
+static size_t evlog_start;	/* Index of the oldest buffered event. */
+static size_t evlog_count;	/* Number of buffered events. */
+static uint32_t evlog_op;	/* Ops since mm_init. */
+static int evlog_depth;		/* Ops in progress inside an op. */
+static int evlog_fd = -1;	/* Where the log goes, if anywhere. */
+
+static void evlog_put(int type, void *header, size_t size, int aux);
+#define EVLOG(type, header, size, aux)	evlog_put(type, header, size, aux)
+#define EVLOG_NEST(n)			((void)(evlog_depth += (n)))
+#else
+#define EVLOG(type, header, size, aux)	((void)0)
+#define EVLOG_NEST(n)			((void)0)
+#endif
 
 /* 
  * Requires:
@@ -119,23 +248,56 @@ static uintptr_t **freelists;
 int
 mm_init(void) 
 {
+	char *p;
 
 	/* Create the initial empty heap. */
 
+	memset(&counters, 0, sizeof(counters));
+	ntouched = 0;
+#ifdef MM_PROBES
+	memset(&probes, 0, sizeof(probes));
+#endif
 	if ((heap_listp = mem_sbrk(24 * WSIZE)) == (void *)-1)
 		return (-1);
+	counters.sbrk_count++;
+#ifdef MM_EVLOG
+	evlog_op = 0;
+	evlog_depth = 0;
+#endif
+	EVLOG(MM_EV_INIT, heap_listp, 24 * WSIZE, 0);
 	PUT(heap_listp, 0);
-	freelists = (uintptr_t **)(heap_listp + WSIZE);                            /* Alignment padding */
+	freelists[0] = (uintptr_t **)(heap_listp + WSIZE);                            /* Alignment padding */
 	PUT(heap_listp + (21 * WSIZE), PACK(DSIZE, 0, 1)); /* Prologue header */ 
 	PUT(heap_listp + (22 * WSIZE), PACK(DSIZE, 0, 1)); /* Prologue footer */ 
-	PUT(heap_listp + (23 * WSIZE), PACK(0, 0, 1));     /* Epilogue header */
+	PUT(heap_listp + (23 * WSIZE), PACK(0, 1, 1));     /* Epilogue header */
 	heap_listp += (23 * WSIZE);
+	first_block[0] = heap_listp;
 
 	/* Initialize the freelists to be NULL */
-	memset((void *)freelists, 0, SEGLISTCOUNT * WSIZE);
+	memset((void *)freelists[0], 0, SEGLISTCOUNT * WSIZE);
+
+	/* Create region 1 empty at the end of the heap, with its epilogue in
+	   front of its list heads, since its blocks are added in front. */
+	nregions = regions_policy ? 2 : 1;
+	if (nregions > 1) {
+		if ((p = mem_sbrk_region(1, 24 * WSIZE)) == (void *)-1)
+			return (-1);
+		counters.sbrk_count++;
+		PUT(p, 0);                                /* Alignment padding */
+		PUT(p + WSIZE, PACK(0, 1, 1));            /* Epilogue header */
+		freelists[1] = (uintptr_t **)(p + (2 * WSIZE));
+		memset((void *)freelists[1], 0, SEGLISTCOUNT * WSIZE);
+		first_block[1] = p + WSIZE;
+	}
 
-	/* Extend the empty heap with a free block of CHUNKSIZE bytes. */
-	if (extend_heap(CHUNKSIZE / WSIZE) == NULL)
+	/* Extend the empty heap with a top block of min_chunk bytes. */
+	memset(top, 0, sizeof(top));
+	memset(fastbins, 0, sizeof(fastbins));
+	list_order = list_policy;
+	memset(nfingers, 0, sizeof(nfingers));
+	chunk = growth.min_chunk;
+	ops = extend_ops = 0;
+	if (extend_top(0, 0) == NULL)
 		return (-1);
 	return (0);
 }
@@ -155,30 +317,54 @@ mm_malloc(size_t size)
 {
 
 	size_t asize;      /* Adjusted block size */
-	size_t extendsize; /* Amount to extend heap if no fit */
-	void *bp;
+	void *bp, *header;
+	int index, region;
+
+	EVLOG(MM_EV_MALLOC, NULL, size, 0);
+	ops++;
 
 	/* Ignore spurious requests. */
 	if (size == 0)
 		return (NULL);
 
+	/* Refuse sizes whose adjusted block size would overflow. */
+	if (size > SIZE_MAX - WSIZE - DSIZE)
+		return (NULL);
+
 	/* Adjust block size to include overhead and alignment reqs. */
 	asize = get_size(size);
 
-	/* Search the free list for a fit. */
-	if ((bp = find_fit(asize)) != NULL) {
-		return (bp - DSIZE);
+	/* Reuse a block of exactly this size from its fast bin. */
+	if (asize <= 33 * DSIZE &&
+	    (header = fastbins[index = get_list_index(asize)]) != NULL) {
+		fastbins[index] = (void *)GET((char *)header + WSIZE);
+		counters.fast_bytes -= asize;
+		EVLOG(MM_EV_ALLOC, header, asize, 0);
+		TOUCH(header);
+		return ((char *)header + WSIZE);
 	}
 
-	/* No fit found.  Get more memory and place the block. */
-	extendsize = MAX(asize , CHUNKSIZE);
-	if ((bp = re_extend_heap(extendsize)) == NULL)
-	{
-		return (NULL);
-	}  
+	/* Search the free list for a fit, draining the fast bins first if
+	   there is none. */
+	if ((bp = find_fit(asize)) != NULL ||
+	    (drain_fastbins() && (bp = find_fit(asize)) != NULL)) {
+		TOUCH(HDRP(bp));
+		return (bp - DSIZE);
+	}
 
-	
-	void* header = place(HDRP(bp), asize);
+	/* No fit found.  Carve the block from the top of its region, growing
+	   it if need be, or from a new block in front of region 1. */
+	region = (nregions > 1 && asize >= LARGE_SIZE);
+	if (region == 1) {
+		if ((header = take_bottom(NULL, asize)) == NULL)
+			return (NULL);
+	} else {
+		if (top[0] == NULL && extend_top(0, asize) == NULL)
+			return (NULL);
+		if ((header = take_top(top[0], asize)) == NULL)
+			return (NULL);
+	}
+	TOUCH(header);
 	/* Return the allocated block's payload pointer*/
 	return (header + WSIZE);
 } 
@@ -195,6 +381,7 @@ mm_free(void *bp)
 {
 
 	size_t size;
+	int index;
 
 	/* Ignore spurious requests. */
 	if (bp == NULL)
@@ -202,12 +389,49 @@ mm_free(void *bp)
 
 	/* Convert to free block's payload pointer*/
 	bp = bp + DSIZE;
+	size = GET_SIZE(HDRP(bp));
+	EVLOG(MM_EV_FREE, HDRP(bp), size, 0);
+
+	/* Cache a block of an exact small size in its fast bin. */
+	if (size <= 33 * DSIZE && (index = get_list_index(size)) < NFASTBINS) {
+		PUT(HDRP(bp) + WSIZE, (uintptr_t)fastbins[index]);
+		fastbins[index] = HDRP(bp);
+		counters.fast_bytes += size;
+		EVLOG(MM_EV_RELEASE, HDRP(bp), size, 0);
+		TOUCH(HDRP(bp));
+		return;
+	}
 
 	/* Free and coalesce the block. */
-	size = GET_SIZE(HDRP(bp));
-	int prev_alloc = GET_PRE_ALLOC(HDRP(bp));
-	PUT(HDRP(bp), PACK(size, prev_alloc, 0));
-	PUT(FTRP(bp), PACK(size, prev_alloc, 0));
+	TOUCH(release_block(HDRP(bp)));
+}
+
+/*
+ * Requires:
+ *   "p" is the address of an allocated block that is not in a fast bin.
+ *
+ * Effects:
+ *   Free the block "p", coalescing it if its size calls for that, and put
+ *   the result on a free list, or into the top block if it ends the heap.
+ *   Returns the header of the resulting free block.
+ */
+static void *
+release_block(void *p)
+{
+	size_t size = GET_SIZE(p);
+	int prev_alloc = GET_PRE_ALLOC(p);
+	void *bp = TO_BLKP(p);
+
+	PUT(p, PACK(size, prev_alloc, 0));
+	PUT(TO_FTRP(p), PACK(size, prev_alloc, 0));
+	EVLOG(MM_EV_RELEASE, p, size, 0);
+
+	/* The last block goes back to the top, whatever its size. */
+	if (NEXT_H(p) == top[REGION_OF(p)] ||
+	    (GET_SIZE(NEXT_H(p)) == 0 && !REGION_OF(p))) {
+		free_to_top(p);
+		return (top[REGION_OF(p)]);
+	}
 
 	/* coalesce the block if it is very small/large or equal Chunksize*/
 	if(size <= 9 * DSIZE || size == CHUNKSIZE 
@@ -215,6 +439,33 @@ mm_free(void *bp)
 		bp = coalesce(bp);
 
 	insert_free_block(HDRP(bp));
+	return (HDRP(bp));
+}
+
+/*
+ * Requires:
+ *   None.
+ *
+ * Effects:
+ *   Free every block in the fast bins for real, so that they can coalesce
+ *   and serve requests of other sizes.  Returns true if there were any.
+ */
+static bool
+drain_fastbins(void)
+{
+	bool drained = false;
+	void *p;
+	int index;
+
+	for (index = 0; index < NFASTBINS; index++) {
+		while ((p = fastbins[index]) != NULL) {
+			fastbins[index] = (void *)GET((char *)p + WSIZE);
+			counters.fast_bytes -= GET_SIZE(p);
+			release_block(p);
+			drained = true;
+		}
+	}
+	return (drained);
 }
 
 /*
@@ -244,15 +495,23 @@ void *mm_realloc(void *ptr, size_t size)
 	if(ptr == NULL)
 		return mm_malloc(size);
 
+	EVLOG(MM_EV_REALLOC, (char *)ptr - WSIZE, size, 0);
+	ops++;
+
 
 	void *newptr = ptr;
 	void *header = ptr - WSIZE;
 	size_t current_size = GET_SIZE(header);
 	void *next_header; 
-	void *prev_header;
+	void *prev_header = NULL;
+	size_t prev_size = 0;
 	size_t asize; /* Adjusted block size */
 
 
+	/* Refuse sizes whose adjusted block size would overflow. */
+	if (size > SIZE_MAX - WSIZE - DSIZE)
+		return (NULL);
+
 	/* Adjust block size to include overhead and alignment reqs. */
 	asize = get_size(size);
 
@@ -261,19 +520,37 @@ void *mm_realloc(void *ptr, size_t size)
 	if(asize > current_size)
 	{
 		next_header = NEXT_H(header);
-		prev_header = PREV_H(header);
 		size_t next_size = GET_SIZE(next_header);
-		size_t prev_size = GET_SIZE(prev_header);
+
+		/* Only a free previous block has a footer to find it by. */
+		if (GET_PRE_ALLOC(header) == 0) {
+			prev_header = PREV_H(header);
+			prev_size = GET_SIZE(prev_header);
+		}
 		
-		if(GET_ALLOC(next_header)==0 && next_size + current_size >= asize)
+		/* Region 1 cannot grow at its end. */
+		if (next_header == top[REGION_OF(header)] ||
+		    (next_size == 0 && !REGION_OF(header)))
+		{
+			/* grow into the top block, which grows first if
+			   it is too small. */
+			EVLOG(MM_EV_RESIZE, header, asize, MM_RESIZE_NEXT);
+			if (take_top(header, asize) == NULL)
+				return (NULL);
+		}
+		else if(GET_ALLOC(next_header)==0 && next_size + current_size >= asize)
 		{
 
 			/* if merge next free alignmented block is enough,
 			   remove the free block from free lists,
 			   merge the block and change flags.*/
 			remove_free_block(next_header, get_list_index(next_size));
+			counters.coalesce_count++;
 			int prev_alloc = GET_PRE_ALLOC(header);
 			PUT(header, PACK(next_size + current_size, prev_alloc, 1));
+			EVLOG(MM_EV_RESIZE, header, next_size + current_size,
+			    MM_RESIZE_NEXT);
+			EVLOG(MM_EV_ALLOC, header, next_size + current_size, 0);
 			uintptr_t value = GET(NEXT_H(header));
 			PUT(NEXT_H(header),value | 0x2);			
 
@@ -284,8 +561,12 @@ void *mm_realloc(void *ptr, size_t size)
 			   remove the free block from free lists,
 			   merge the block and change flags.*/			
 			remove_free_block(prev_header, get_list_index(prev_size));
+			counters.coalesce_count++;
 			int prev_alloc = GET_PRE_ALLOC(prev_header);
 			PUT(prev_header, PACK(prev_size + current_size, prev_alloc, 1));
+			EVLOG(MM_EV_RESIZE, prev_header, prev_size + current_size,
+			    MM_RESIZE_PREV);
+			EVLOG(MM_EV_ALLOC, prev_header, prev_size + current_size, 0);
 			memmove(prev_header + WSIZE, ptr, MIN(size, current_size  - WSIZE));
 			newptr = (prev_header + WSIZE);
 		}
@@ -297,26 +578,416 @@ void *mm_realloc(void *ptr, size_t size)
 			   merge the block and change flags.*/			
 			remove_free_block(prev_header, get_list_index(prev_size));
 			remove_free_block(next_header, get_list_index(next_size));
+			counters.coalesce_count += 2;
 			int prev_alloc = GET_PRE_ALLOC(prev_header);
 			PUT(prev_header, PACK(prev_size + current_size + next_size, prev_alloc, 1));
-			uintptr_t value = GET(NEXT_H(header));
-			PUT(NEXT_H(header),value | 0x2);
+			EVLOG(MM_EV_RESIZE, prev_header,
+			    prev_size + current_size + next_size, MM_RESIZE_BOTH);
+			EVLOG(MM_EV_ALLOC, prev_header,
+			    prev_size + current_size + next_size, 0);
+			uintptr_t value = GET(NEXT_H(prev_header));
+			PUT(NEXT_H(prev_header),value | 0x2);
+			memmove(prev_header + WSIZE, ptr, MIN(size, current_size  - WSIZE));
+			newptr = (prev_header + WSIZE);
+		}
+		else if (REGION_OF(header) && (header == first_block[1] ||
+		    (prev_header != NULL && prev_header == first_block[1])))
+		{
+			/* grow down into the free block in front, or into
+			   new space in front of region 1. */
+			EVLOG(MM_EV_RESIZE, header, asize, MM_RESIZE_PREV);
+			if ((prev_header = take_bottom(header, asize)) == NULL)
+				return (NULL);
 			memmove(prev_header + WSIZE, ptr, MIN(size, current_size  - WSIZE));
 			newptr = (prev_header + WSIZE);
 		}
 		else
 		{
 			// malloc a new block and copy the data
-			newptr = mm_malloc(size);
-			memcpy(newptr, ptr, MIN(size, current_size - WSIZE));
-			mm_free(ptr);
+			EVLOG(MM_EV_RESIZE, header, current_size,
+			    MM_RESIZE_MOVE);
+			EVLOG_NEST(1);
+			if ((newptr = mm_malloc(size)) != NULL) {
+				memcpy(newptr, ptr, MIN(size, current_size - WSIZE));
+				mm_free(ptr);
+			}
+			EVLOG_NEST(-1);
 		}
 	}
+	else
+		EVLOG(MM_EV_RESIZE, header, current_size, MM_RESIZE_INPLACE);
 
 	//return the reallocation block
+	if (newptr != NULL)
+		TOUCH((char *)newptr - WSIZE);
 	return newptr;
 }
 
+/*
+ * Requires:
+ *   "alignment" is a power of two.
+ *
+ * Effects:
+ *   Allocate a block with at least "size" bytes of payload whose address
+ *   is a multiple of "alignment".  Returns the address of this block if
+ *   the allocation was successful and NULL otherwise.  The block is
+ *   carved out of a free block that holds it, or else out of a larger
+ *   block from mm_malloc, and the parts in front of the aligned payload
+ *   and past the block are freed, so that they can coalesce.
+ */
+void *
+mm_memalign(size_t alignment, size_t size)
+{
+	char *ptr;
+	void *header, *new_header, *tail = NULL;
+	size_t lead, rest, asize;
+	unsigned int nt;
+
+	EVLOG(MM_EV_MEMALIGN, NULL, size, __builtin_ctzl(alignment));
+
+	/* Every payload is already double-word aligned. */
+	if (alignment <= DSIZE) {
+		EVLOG_NEST(1);
+		ptr = mm_malloc(size);
+		EVLOG_NEST(-1);
+		return (ptr);
+	}
+	if (size > SIZE_MAX - alignment - 2 * DSIZE)
+		return (NULL);
+
+	/* Reuse a free block that holds the aligned block, such as a freed
+	   one.  Otherwise, leave room in front for a free block of the
+	   minimum size. */
+	asize = get_size(size);
+	if ((header = find_aligned_fit(alignment, asize)) == NULL) {
+		/* The block is split up below, so forget what mm_malloc
+		   touched: the pieces are touched as they are left. */
+		nt = ntouched;
+		EVLOG_NEST(1);
+		ptr = mm_malloc(size + alignment + 2 * DSIZE);
+		EVLOG_NEST(-1);
+		ntouched = nt;
+		if (ptr == NULL)
+			return (NULL);
+		header = ptr - WSIZE;
+	}
+
+	/* Split the block into the leading part, if the payload is not
+	   aligned already, the aligned block, and the tail past it, if the
+	   tail makes a block. */
+	lead = align_lead(header, alignment);
+	new_header = (char *)header + lead;
+	rest = GET_SIZE(header) - lead;
+	EVLOG(MM_EV_SPLIT, header, GET_SIZE(header), MM_SPLIT_ALIGN);
+	if (rest >= asize + 2 * DSIZE) {
+		tail = (char *)new_header + asize;
+		PUT(tail, PACK(rest - asize, 1, 1));
+		rest = asize;
+	}
+	EVLOG(MM_EV_ALLOC, new_header, rest, 0);
+	if (lead > 0) {
+		PUT(new_header, PACK(rest, 0, 1));
+		PUT(header, PACK(lead, GET_PRE_ALLOC(header), 1));
+	} else
+		PUT(new_header, PACK(rest, GET_PRE_ALLOC(header), 1));
+
+	/* Free the leading part and the tail. */
+	if (lead > 0) {
+		counters.split_count++;
+		TOUCH(release_block(header));
+	}
+	TOUCH(new_header);
+	if (tail != NULL) {
+		counters.split_count++;
+		TOUCH(release_block(tail));
+	}
+
+	return ((char *)new_header + WSIZE);
+}
+
+/*
+ * Requires:
+ *   "ptr" is the address of an allocated block.
+ *
+ * Effects:
+ *   Returns the number of bytes of payload in the block "ptr", which may
+ *   be more than were requested.
+ */
+size_t
+mm_usable_size(void *ptr)
+{
+
+	return (GET_SIZE((char *)ptr - WSIZE) - WSIZE);
+}
+
+/*
+ * An arena's chunks, newest first, each linked to the next older one
+ * through its first word, with its blocks starting DSIZE bytes in.  Only
+ * the newest chunk has room left, from "next" to "end".
+ */
+struct mm_arena {
+	void	*chunks;	/* The newest chunk, or NULL. */
+	char	*next;		/* The newest chunk's first unused byte... */
+	char	*end;		/* ... and the byte after it. */
+	size_t	chunk_size;	/* Bytes of blocks that a chunk holds. */
+};
+
+/*
+ * Requires:
+ *   None.
+ *
+ * Effects:
+ *   Create an empty arena whose chunks hold "chunk_size" bytes of blocks,
+ *   or MM_ARENA_CHUNK if "chunk_size" is zero.  Returns the arena, or NULL
+ *   if it could not be allocated.
+ */
+mm_arena_t *
+mm_arena_create(size_t chunk_size)
+{
+	mm_arena_t *arena;
+
+	if (chunk_size > SIZE_MAX / 2)
+		return (NULL);
+	if ((arena = mm_malloc(sizeof(*arena))) == NULL)
+		return (NULL);
+	arena->chunks = NULL;
+	arena->next = arena->end = NULL;
+	arena->chunk_size = (chunk_size == 0) ? MM_ARENA_CHUNK :
+	    (chunk_size + DSIZE - 1) & ~(DSIZE - 1);
+	return (arena);
+}
+
+/*
+ * Requires:
+ *   "arena" was returned by mm_arena_create.
+ *
+ * Effects:
+ *   Allocate a block with at least "size" bytes of payload from "arena",
+ *   unless "size" is zero.  Returns the address of this block if the
+ *   allocation was successful and NULL otherwise.  A block of more than
+ *   half a chunk gets a chunk of its own, behind the newest chunk, so
+ *   that the room left in that chunk is not wasted.
+ */
+void *
+mm_arena_alloc(mm_arena_t *arena, size_t size)
+{
+	char *chunk;
+
+	if (size == 0 || size > SIZE_MAX / 2)
+		return (NULL);
+	size = (size + DSIZE - 1) & ~(DSIZE - 1);
+
+	/* Bump the pointer if the newest chunk has room. */
+	if (size <= (size_t)(arena->end - arena->next)) {
+		arena->next += size;
+		return (arena->next - size);
+	}
+
+	/* Give a large block a chunk of its own. */
+	if (size > arena->chunk_size / 2 && arena->chunks != NULL) {
+		if ((chunk = mm_malloc(DSIZE + size)) == NULL)
+			return (NULL);
+		PUT(chunk, GET(arena->chunks));
+		PUT(arena->chunks, (uintptr_t)chunk);
+		return (chunk + DSIZE);
+	}
+
+	/* Start a new chunk. */
+	if ((chunk = mm_malloc(DSIZE + MAX(size, arena->chunk_size))) == NULL)
+		return (NULL);
+	PUT(chunk, (uintptr_t)arena->chunks);
+	arena->chunks = chunk;
+	arena->next = chunk + DSIZE + size;
+	arena->end = chunk + DSIZE + MAX(size, arena->chunk_size);
+	return (chunk + DSIZE);
+}
+
+/*
+ * Requires:
+ *   "arena" was returned by mm_arena_create.
+ *
+ * Effects:
+ *   Free every block allocated from "arena" by freeing all of its chunks
+ *   but the newest, which is emptied for reuse if it is of the usual
+ *   size.
+ */
+void
+mm_arena_reset(mm_arena_t *arena)
+{
+	char *chunk, *older;
+
+	if ((chunk = arena->chunks) == NULL)
+		return;
+	older = (char *)GET(chunk);
+	if ((size_t)(arena->end - chunk) == DSIZE + arena->chunk_size) {
+		PUT(chunk, 0);
+		arena->next = chunk + DSIZE;
+	} else {
+		mm_free(chunk);
+		arena->chunks = NULL;
+		arena->next = arena->end = NULL;
+	}
+	for (chunk = older; chunk != NULL; chunk = older) {
+		older = (char *)GET(chunk);
+		mm_free(chunk);
+	}
+}
+
+/*
+ * Requires:
+ *   "arena" was returned by mm_arena_create, or is NULL.
+ *
+ * Effects:
+ *   Free "arena" with all of its chunks.
+ */
+void
+mm_arena_destroy(mm_arena_t *arena)
+{
+
+	if (arena == NULL)
+		return;
+	mm_arena_reset(arena);
+	mm_free(arena->chunks);
+	mm_free(arena);
+}
+
+/*
+ * Requires:
+ *   None.
+ *
+ * Effects:
+ *   Fill in "*stats" from the allocator's counters.  Only the largest
+ *   free block must be searched for: it is in the largest nonempty class,
+ *   since the classes from 7 on hold increasing sizes, or else in one of
+ *   the small classes.
+ */
+void
+mm_get_stats(mm_stats_t *stats)
+{
+	int index, last, region;
+	void *p;
+
+	*stats = counters;
+	stats->heap_size = mem_heapsize();
+	if (stats->heap_size == 0)
+		return;
+	for (region = 0; region < nregions; region++) {
+		if (top[region] == NULL)
+			continue;
+		stats->top_size += GET_SIZE(top[region]);
+		stats->largest_free = MAX(stats->largest_free,
+		    GET_SIZE(top[region]));
+	}
+	stats->free_bytes = stats->top_size + counters.fast_bytes;
+	for (index = 0; index < SEGLISTCOUNT; index++)
+		stats->free_bytes += counters.class_bytes[index];
+
+	/* Everything but the list heads, prologues and epilogues is a block. */
+	stats->alloc_bytes = stats->heap_size - nregions * 24 * WSIZE -
+	    stats->free_bytes;
+
+	for (region = 0; region < nregions; region++) {
+		for (last = SEGLISTCOUNT - 1; last > 6; last--)
+			if (freelists[region][last] != NULL)
+				break;
+		for (index = (last > 6) ? last : 0; index <= last; index++) {
+			if ((p = freelists[region][index]) == NULL)
+				continue;
+			do {
+				stats->largest_free = MAX(stats->largest_free,
+				    GET_SIZE(p));
+				p = (void *)GET_NEXT(p);
+			} while (p != freelists[region][index]);
+		}
+	}
+}
+
+/*
+ * Requires:
+ *   None.
+ *
+ * Effects:
+ *   Copy the hot-path probes into "*p" and return 1 if mm.c was built with
+ *   MM_PROBES.  Otherwise, return 0.
+ */
+int
+mm_get_probes(mm_probes_t *p)
+{
+
+#ifdef MM_PROBES
+	*p = probes;
+	return (1);
+#else
+	(void)p;
+	return (0);
+#endif
+}
+
+/*
+ * Requires:
+ *   "fd" is a file descriptor open for writing, or -1.
+ *
+ * Effects:
+ *   Write the event log to "fd" from now on, starting with its header,
+ *   or stop writing it if "fd" is -1.  Events buffered before the call are
+ *   written to the previous file descriptor, if any, or else discarded.
+ *   Returns 1 if mm.c was built with MM_EVLOG and 0 otherwise.
+ */
+int
+mm_evlog_attach(int fd)
+{
+
+#ifdef MM_EVLOG
+	uint32_t header[2] = {sizeof(mm_event_t), MM_EV_NTYPES};
+
+	mm_evlog_flush();
+	evlog_start = evlog_count = 0;
+	if ((evlog_fd = fd) >= 0) {
+		if (write(fd, MM_EVLOG_MAGIC, 8) != 8 ||
+		    write(fd, header, sizeof(header)) != sizeof(header))
+			evlog_fd = -1;
+	}
+	return (1);
+#else
+	(void)fd;
+	return (0);
+#endif
+}
+
+/*
+ * Requires:
+ *   None.
+ *
+ * Effects:
+ *   Write the buffered events to the attached file descriptor, if any, and
+ *   empty the ring.  A failed write detaches the file descriptor.
+ */
+void
+mm_evlog_flush(void)
+{
+
+#ifdef MM_EVLOG
+	size_t n, len;
+	ssize_t done;
+	char *p;
+
+	while (evlog_fd >= 0 && evlog_count > 0) {
+		/* Write up to the end of the ring, then wrap around. */
+		n = MIN(evlog_count, MM_EVLOG_SIZE - evlog_start);
+		p = (char *)&evlog[evlog_start];
+		for (len = n * sizeof(mm_event_t); len > 0; len -= done) {
+			if ((done = write(evlog_fd, p, len)) <= 0) {
+				evlog_fd = -1;
+				return;
+			}
+			p += done;
+		}
+		evlog_start = (evlog_start + n) % MM_EVLOG_SIZE;
+		evlog_count -= n;
+	}
+#endif
+}
+
 /*
  * The following routines are internal helper routines.
  */
@@ -435,6 +1106,7 @@ coalesce(void *bp)
     	int prev_alloc = GET_PRE_ALLOC(HDRP(bp));
     	int next_alloc = GET_NEXT_ALLOC(HDRP(bp));
 	
+	PROBE(coalesce[(!prev_alloc << 1) | !next_alloc]++);
 	
 	if ((prev_alloc == 1) && (next_alloc == 1)) {  
 
@@ -449,8 +1121,10 @@ coalesce(void *bp)
         	/* coalesce with next block. */
 
 		// only coalesce large blocks
-		if(GET_SIZE(NEXT_H(HDRP(bp))) <= 17 * DSIZE)
+		if(GET_SIZE(NEXT_H(HDRP(bp))) <= 17 * DSIZE) {
+			PROBE(coalesce_declined[MM_COALESCE_NEXT]++);
 			return (bp);
+		}
 		void* next_header = HDRP(NEXT_BLKP(bp));
 		size_t next_size = GET_SIZE(next_header);
 		int next_index = get_list_index(next_size);
@@ -462,17 +1136,21 @@ coalesce(void *bp)
 
 		// remove merged free blocks from free lists		
         	remove_free_block(next_header, next_index);
+		counters.coalesce_count++;
 
 		// update the merged block's header and footer.		
 		PUT(header, PACK(size, 1, 0));
 		PUT(FTRP(bp), PACK(size, 1, 0));
+		EVLOG(MM_EV_COALESCE, header, size, MM_COALESCE_NEXT);
 	} else if ((prev_alloc == 0) && (next_alloc == 1)) {     
 
       		/* coalesce with previous block */
 
 		// only coalesce large blocks
-		if (GET_SIZE(PREV_H(HDRP(bp))) <= 17 * DSIZE)
+		if (GET_SIZE(PREV_H(HDRP(bp))) <= 17 * DSIZE) {
+			PROBE(coalesce_declined[MM_COALESCE_PREV]++);
 			return(bp);
+		}
 		void* prev_header = HDRP(PREV_BLKP(bp));
 		size_t prev_size = GET_SIZE(prev_header);
 		int prev_index = get_list_index(prev_size);
@@ -482,10 +1160,12 @@ coalesce(void *bp)
 
 		// remove merged free blocks from free lists				
         	remove_free_block(prev_header, prev_index);
+		counters.coalesce_count++;
 
 		// update the merged block's header and footer.
 		PUT(FTRP(bp), PACK(size, 1, 0));
 		PUT(prev_header, PACK(size, 1, 0));
+		EVLOG(MM_EV_COALESCE, prev_header, size, MM_COALESCE_PREV);
 		bp = PREV_BLKP(bp);
 
 		// update the next alligment block's prev_alloc flag.
@@ -497,6 +1177,7 @@ coalesce(void *bp)
 		// only coalesce large blocks
 		if (GET_SIZE(PREV_H(HDRP(bp))) <= 17 * DSIZE
 		 && GET_SIZE(NEXT_H(HDRP(bp))) <= 17 * DSIZE) {
+			 PROBE(coalesce_declined[MM_COALESCE_BOTH]++);
 			 return (bp);
 		}
 
@@ -517,90 +1198,330 @@ coalesce(void *bp)
 		// remove merged free blocks from free lists
         	remove_free_block(next_header, next_index);   
         	remove_free_block(prev_header, prev_index);
+		counters.coalesce_count += 2;
 
 		// update the merged block's header and footer.
 		PUT(prev_header, PACK(size, 1, 0));
 		PUT(FTRP(NEXT_BLKP(bp)), PACK(size, 1, 0));
+		EVLOG(MM_EV_COALESCE, prev_header, size, MM_COALESCE_BOTH);
 		bp = PREV_BLKP(bp);
 	}
 	return(bp);
 }
 
-/* 
+/*
  * Requires:
- *   None.
+ *   "need" is a multiple of DSIZE.
+ *
+ * Effects:
+ *   Returns how many bytes to extend the heap by, at least "need", under
+ *   the growth policy.  Extensions that come within "window" ops of each
+ *   other double the extension size, and ones that come more than four
+ *   times as far apart halve it, within the policy's bounds.
+ */
+static size_t
+grow_size(size_t need)
+{
+	size_t cap;
+
+	if (ops - extend_ops < growth.window)
+		chunk *= 2;
+	else if (ops - extend_ops > 4 * (size_t)growth.window)
+		chunk /= 2;
+	extend_ops = ops;
+
+	/* Never grow by more than heap_percent of the heap at once. */
+	cap = MIN(growth.max_chunk,
+	    mem_heapsize() / 100 * growth.heap_percent);
+	chunk = MAX(MIN(chunk, cap), growth.min_chunk) & ~(DSIZE - 1);
+	return (MAX(need, chunk));
+}
+
+/*
+ * Requires:
+ *   "region" is a region in use.  "*sizep" is a multiple of DSIZE.
  *
  * Effects:
- *   Extend the heap with a free block and return that block's address.
+ *   Extend the region by as much as the growth policy asks for to hold
+ *   "*sizep" bytes, or by as much as the heap has room for if that is
+ *   less, but by no less than "*sizep" bytes or a block, and set "*sizep"
+ *   to the size of the extension.  Returns the start of the new space, or
+ *   NULL if the region could not be extended.
  */
 static void *
-extend_heap(size_t words) 
+grow_region(int region, size_t *sizep)
 {
-	size_t size;
+	size_t need = MAX(*sizep, 2 * DSIZE), size = grow_size(need);
 	void *start;
 
-	/* Allocate an even number of words to maintain alignment. */
-	if (words <= 4)
-		size = 2 * DSIZE;
-	else
-	{
-		size = (words % 2) ? (words + 1) * WSIZE : words * WSIZE;
-	}
-
-	
-	
-	if ((start = mem_sbrk(size)) == (void *)-1)  
+	/* Ask for no more than the heap has room for, so that mem_sbrk only
+	   fails when not even "need" bytes are left, but no less than a
+	   block. */
+	PROBE(extend_calls++);
+	size = MAX(MIN(size, mem_heaproom() & ~(DSIZE - 1)), need);
+	if ((start = mem_sbrk_region(region, size)) == (void *)-1)
 		return (NULL);
+	counters.sbrk_count++;
+	*sizep = size;
+	return (start);
+}
 
-	/* Initialize free block header/footer and the epilogue header. */
-	PUT(start - WSIZE, PACK(size, 1, 0));         /* Free block header */
-	PUT(FTRP(start + DSIZE), PACK(size, 0, 0));         /* Free block footer */
-	PUT(start + size - WSIZE, PACK(0, 0, 1)); /* New epilogue header */
-	insert_free_block(start - WSIZE); 
-
+/* 
+ * Requires:
+ *   "region" is region 0.  "need" is a multiple of DSIZE.
+ *
+ * Effects:
+ *   Extend the region by at least "need" bytes, as much as the growth
+ *   policy asks for if the region has room, and make them its top block or
+ *   add them to it.  Returns the top block's header, or NULL if the region
+ *   could not be extended.
+ */
+static void *
+extend_top(int region, size_t need) 
+{
+	size_t size = need;
+	void *start;
 
-	/* Coalesce if the previous block was free. */
-	return (start + DSIZE);
+	if ((start = grow_region(region, &size)) == NULL)
+		return (NULL);
+	EVLOG(MM_EV_EXTEND, start - WSIZE, size, 0);
+
+	/* The new space takes over the old epilogue's word. */
+	if (top[region] == NULL)
+		set_top(start - WSIZE, size, GET_PRE_ALLOC(start - WSIZE));
+	else {
+		set_top(top[region], GET_SIZE(top[region]) + size,
+		    GET_PRE_ALLOC(top[region]));
+		EVLOG(MM_EV_COALESCE, top[region], GET_SIZE(top[region]),
+		    MM_COALESCE_NEXT);
+	}
+	return (top[region]);
 }
 
+/*
+ * Requires:
+ *   Region 1 is in use.  "p" is NULL, the region's first block, or the
+ *   allocated block after it if that is free.  "asize" is a multiple of
+ *   DSIZE and at least the size of the block "p".
+ *
+ * Effects:
+ *   Grow the block "p", or a new block that ends where the region's first
+ *   block ends if that is free or else where it starts if "p" is NULL, down
+ *   to an allocated block of "asize" bytes at the expense of the free first
+ *   block, extending the region down first if that is too small.  What is
+ *   left is split off in front as the new first block if it would be at
+ *   least the minimum block size, so that the next extension merges with
+ *   it.  Returns the header of the grown block, whose payload has not
+ *   moved from "p", or NULL if the region could not be extended.
+ */
+static void *
+take_bottom(void *p, size_t asize)
+{
+	char *first = first_block[1], *header;
+	size_t size = (p != NULL) ? GET_SIZE(p) : 0;
+	size_t free_size = 0, more;
+
+	/* The epilogue of an empty region counts as allocated. */
+	if (first != p && !GET_ALLOC(first))
+		free_size = GET_SIZE(first);
+	if (size + free_size < asize) {
+		more = asize - size - free_size;
+		if (grow_region(1, &more) == NULL)
+			return (NULL);
+		EVLOG(MM_EV_EXTEND, first - more, more, 0);
+	} else
+		more = 0;
+	if (free_size > 0) {
+		remove_free_block(first, get_list_index(free_size));
+		if (more > 0) {
+			counters.coalesce_count++;
+			EVLOG(MM_EV_COALESCE, first - more, more + free_size,
+			    MM_COALESCE_NEXT);
+		}
+	}
 
-/* 
+	/* The new space takes over the old alignment padding. */
+	header = first - more;
+	first_block[1] = header;
+	PUT(header - WSIZE, 0);                       /* Alignment padding */
+	size += free_size + more;
+	if (size - asize >= 2 * DSIZE) {
+		counters.split_count++;
+		EVLOG(MM_EV_SPLIT, header, size, MM_SPLIT_FRONT);
+		PUT(header, PACK(size - asize, 1, 0));
+		PUT(TO_FTRP(header), PACK(size - asize, 1, 0));
+		insert_free_block(header);
+		header = NEXT_H(header);
+		PUT(header, PACK(asize, 0, 1));
+	} else
+		PUT(header, PACK(size, 1, 1));
+	EVLOG(MM_EV_ALLOC, header, GET_SIZE(header), 0);
+	PUT(NEXT_H(header), GET(NEXT_H(header)) | 0x2);
+	return (header);
+}
+
+/*
  * Requires:
  *   None.
  *
  * Effects:
- *   Re-extend the heap with a free block and return that block's address
- *   and write the prev-alloc flags from the previous epilogue to new 
- *   free blocks.
+ *   Adopt "policy" as the heap growth policy from the next call to
+ *   mm_init on, or the default policy if "policy" is NULL.  A min_chunk
+ *   that is not a multiple of the alignment is rounded up.
  */
-static void *
-re_extend_heap(size_t size) 
+void
+mm_set_growth_policy(const mm_growth_t *policy)
 {
+	static const mm_growth_t defaults = GROWTH_DEFAULT;
 
+	growth = (policy != NULL) ? *policy : defaults;
+	growth.min_chunk = (MAX(growth.min_chunk, 2 * DSIZE) + DSIZE - 1) &
+	    ~(DSIZE - 1);
+	growth.max_chunk = MAX(growth.max_chunk, growth.min_chunk);
+}
 
-	void *start;
+/*
+ * Requires:
+ *   "policy" is MM_LIST_FIFO, MM_LIST_LIFO or MM_LIST_ADDRESS.
+ *
+ * Effects:
+ *   Order the free lists by "policy" from the next call to mm_init on.
+ */
+void
+mm_set_list_policy(int policy)
+{
 
-	if ((start = mem_sbrk(size)) == (void *)-1)  
-		return (NULL);
+	list_policy = policy;
+}
 
+/*
+ * Requires:
+ *   None.
+ *
+ * Effects:
+ *   Give blocks of at least LARGE_SIZE bytes a heap region of their own
+ *   if "on" is nonzero, or keep all blocks in one region if it is zero,
+ *   from the next call to mm_init on.
+ */
+void
+mm_set_regions(int on)
+{
 
-	/* Initialize free block header/footer, the epilogue header 
-	   and inherit the flags. */
-	PUT(start - WSIZE, PACK(size, GET_PRE_ALLOC(start - WSIZE), 0));      
-	PUT(FTRP(start + DSIZE), PACK(size, GET_PRE_ALLOC(start - WSIZE), 0));      
-	PUT(start + size - WSIZE, PACK(0, 0, 1)); /* New epilogue header */
+	regions_policy = (on != 0);
+}
 
-	// convert to free block payload pointer, coalesce and insert it 
-	void* bp = start + DSIZE;
-	bp = coalesce(bp);
-	insert_free_block(HDRP(bp));
+/*
+ * Requires:
+ *   None.
+ *
+ * Effects:
+ *   Have find_fit look at up to "k" blocks that fit in a class, taking
+ *   the smallest of them, from now on.  A "k" of 0 or 1 is first fit.
+ */
+void
+mm_set_fit_search(unsigned int k)
+{
 
+	fit_search = MAX(k, 1);
+}
 
-	return (bp);
+/*
+ * Requires:
+ *   "p" is the address of a block header that ends its region.
+ *
+ * Effects:
+ *   Make the block "p" its region's top block, with a footer and a new
+ *   epilogue after it.
+ */
+static void
+set_top(void *p, size_t size, int prev_alloc)
+{
+
+	top[REGION_OF(p)] = p;
+	PUT(p, PACK(size, prev_alloc, 0));
+	PUT(TO_FTRP(p), PACK(size, prev_alloc, 0));
+	PUT(NEXT_H(p), PACK(0, 0, 1));                /* Epilogue header */
 }
 
+/*
+ * Requires:
+ *   "p" is either the top block of its region or the allocated block
+ *   before it, or the last block of the region if there is no top block.
+ *   "asize" is at least the size of the block "p".
+ *
+ * Effects:
+ *   Grow the block "p" to an allocated block of "asize" bytes at the
+ *   expense of the top block, extending the region first if the top block
+ *   is too small, and split what is left off as the new top block if it
+ *   would be at least the minimum block size.  Returns "p", or NULL if
+ *   the region could not be extended.
+ */
+static void *
+take_top(void *p, size_t asize)
+{
+	int region = REGION_OF(p);
+	size_t size = (p == top[region]) ? 0 : GET_SIZE(p);
+	size_t top_size = (top[region] != NULL) ? GET_SIZE(top[region]) : 0;
+	int prev_alloc = GET_PRE_ALLOC(p);
+
+	if (size + top_size < asize) {
+		if (extend_top(region, asize - size - top_size) == NULL)
+			return (NULL);
+		top_size = GET_SIZE(top[region]);
+	}
 
+	if (size + top_size - asize >= 2 * DSIZE) {
+		counters.split_count++;
+		EVLOG(MM_EV_SPLIT, top[region], top_size, MM_SPLIT_BACK);
+		PUT(p, PACK(asize, prev_alloc, 1));
+		EVLOG(MM_EV_ALLOC, p, asize, 0);
+		set_top(NEXT_H(p), size + top_size - asize, 1);
+		EVLOG(MM_EV_RELEASE, top[region], GET_SIZE(top[region]), 0);
+	} else {
+		PUT(p, PACK(size + top_size, prev_alloc, 1));
+		EVLOG(MM_EV_ALLOC, p, size + top_size, 0);
+		PUT(NEXT_H(p), PACK(0, 1, 1));        /* Epilogue header */
+		top[region] = NULL;
+	}
+	return (p);
+}
 
+/*
+ * Requires:
+ *   "p" is the address of a newly freed block that ends its region or is
+ *   followed by the region's top block.
+ *
+ * Effects:
+ *   Merge the block "p" into the top block, together with the previous
+ *   block if that is free, or else make it the top block.
+ */
+static void
+free_to_top(void *p)
+{
+	size_t size = GET_SIZE(p);
+	int prev_alloc = GET_PRE_ALLOC(p);
+	int which = MM_COALESCE_NONE;
+	void *prev;
+
+	if (top[REGION_OF(p)] != NULL) {
+		size += GET_SIZE(top[REGION_OF(p)]);
+		counters.coalesce_count++;
+		which |= MM_COALESCE_NEXT;
+	}
+	if (!prev_alloc) {
+		prev = PREV_H(p);
+		remove_free_block(prev, get_list_index(GET_SIZE(prev)));
+		counters.coalesce_count++;
+		which |= MM_COALESCE_PREV;
+		size += GET_SIZE(prev);
+		prev_alloc = GET_PRE_ALLOC(prev);
+		p = prev;
+	}
+	PROBE(coalesce[which]++);
+	set_top(p, size, prev_alloc);
+	if (which != MM_COALESCE_NONE)
+		EVLOG(MM_EV_COALESCE, p, size, which);
+}
 
 /*
  * Requires: 
@@ -615,18 +1536,36 @@ remove_free_block(void* p, int index)
 
 	uintptr_t prev = GET_PREV(p);
 	uintptr_t next = GET_NEXT(p);
+	int region = REGION_OF(p);
+	int i;
+
+	counters.class_blocks[index]--;
+	counters.class_bytes[index] -= GET_SIZE(p);
+	EVLOG(MM_EV_REMOVE, p, GET_SIZE(p), 0);
+
+	/* forget p if it is a finger */
+	if (list_order == MM_LIST_ADDRESS && nfingers[region][index] > 0) {
+		i = find_finger(index, p);
+		if (i < nfingers[region][index] &&
+		    fingers[region][index][i] == p) {
+			nfingers[region][index]--;
+			memmove(&fingers[region][index][i],
+			    &fingers[region][index][i + 1],
+			    (nfingers[region][index] - i) * sizeof(void *));
+		}
+	}
 
 	/* if only one block in the list, empty the list*/
 	if((void*) prev == p)
 	{	
-		freelists[index] = NULL;
+		freelists[region][index] = NULL;
 		return;
 	}	
 
 	/* if remove the first one, let the list 
 	   pointer be the second block pointer*/
-	if(p == freelists[index])
-		freelists[index] = (void*)next;
+	if(p == freelists[region][index])
+		freelists[region][index] = (void*)next;
 
 	/* remove the block*/
 	PUT_NEXT(prev, next);
@@ -645,23 +1584,98 @@ insert_free_block(void* p)
 {
 
 	int index = get_list_index(GET_SIZE(p));
-	void* location = freelists[index];
+	uintptr_t **lists = freelists[REGION_OF(p)];
+	void* location = lists[index];
+	void *after;
+	int i, steps;
+
+	counters.class_blocks[index]++;
+	counters.class_bytes[index] += GET_SIZE(p);
+	EVLOG(MM_EV_INSERT, p, GET_SIZE(p), 0);
 
 	/* if the list is empty, let the list pointer be p*/
 	if(location == NULL)
 	{
-		freelists[index] = p;
+		lists[index] = p;
 		PUT_PREV(p, (uintptr_t)p);
 		PUT_NEXT(p, (uintptr_t)p);
 		return;
 	}
 
-	/* insert the block in the end */
+	/* in address order, insert the block after the last block below it,
+	   found from the closest finger below it */
+	if (list_order == MM_LIST_ADDRESS && p > location) {
+		i = find_finger(index, p);
+		after = (i > 0) ? fingers[REGION_OF(p)][index][i - 1] :
+		    location;
+		for (steps = 0; (void *)GET_NEXT(after) != location &&
+		    (void *)GET_NEXT(after) < p; steps++)
+			after = (void *)GET_NEXT(after);
+		if (steps > FINGER_GAP)
+			add_finger(index, i, p);
+		location = (void *)GET_NEXT(after);
+	}
+
+	/* insert the block in the end, i.e., before "location" */
 	uintptr_t last = GET_PREV(location);
 	PUT_PREV(p, last);
 	PUT_NEXT(p, (uintptr_t)location);
 	PUT_NEXT(last, (uintptr_t)p);
 	PUT_PREV(location, (uintptr_t)p);
+
+	/* a block inserted before the head becomes the head under LIFO,
+	   and under address order if it is the lowest */
+	if (location == lists[index] && (list_order == MM_LIST_LIFO ||
+	    (list_order == MM_LIST_ADDRESS && p < location)))
+		lists[index] = p;
+}
+
+/*
+ * Requires:
+ *   index is a valid free list index
+ * Effects:
+ *   Return the number of fingers of list index in p's region that are
+ *   below p, i.e., the position of p in the index.
+ */
+static int
+find_finger(int index, void *p)
+{
+	void **f = fingers[REGION_OF(p)][index];
+	int lo = 0, hi = nfingers[REGION_OF(p)][index], mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (f[mid] < p)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return (lo);
+}
+
+/*
+ * Requires:
+ *   p is on list index, and i is its position in the index
+ * Effects:
+ *   Add p to the fingers of list index in p's region, first dropping
+ *   every other finger if the index is full.
+ */
+static void
+add_finger(int index, int i, void *p)
+{
+	void **f = fingers[REGION_OF(p)][index];
+	int *n = &nfingers[REGION_OF(p)][index];
+	int j;
+
+	if (*n == NFINGERS) {
+		for (j = 0; j < NFINGERS / 2; j++)
+			f[j] = f[2 * j + 1];
+		*n = NFINGERS / 2;
+		i = find_finger(index, p);
+	}
+	memmove(&f[i + 1], &f[i], (*n - i) * sizeof(void *));
+	f[i] = p;
+	(*n)++;
 }
 
 /* 
@@ -688,11 +1702,15 @@ place(void *p, size_t asize)
 	   place in the front*/
 	if ( (asize < 33 * DSIZE)  && (csize - asize) >= (9 * DSIZE)) {
 	
+		counters.split_count++;
+		PROBE(place_front++);
+		EVLOG(MM_EV_SPLIT, header, csize, MM_SPLIT_FRONT);
 		PUT(header, PACK(csize - asize, prev_alloc,0));
 		PUT(TO_FTRP(header), PACK(csize - asize, prev_alloc, 0));
 		insert_free_block(header);
 		header = NEXT_H(header);
 		PUT(header, PACK(asize, 0, 1));
+		EVLOG(MM_EV_ALLOC, header, asize, 0);
 		void* next = NEXT_H(header);
 		uintptr_t value = GET(next) | 0x2;
 		PUT(next, value);
@@ -703,7 +1721,11 @@ place(void *p, size_t asize)
 	   place in the back*/
 	else if ((csize - asize) >= (9 * DSIZE)) {
 
+		counters.split_count++;
+		PROBE(place_back++);
+		EVLOG(MM_EV_SPLIT, header, csize, MM_SPLIT_BACK);
 		PUT(header, PACK(asize, prev_alloc,1));
+		EVLOG(MM_EV_ALLOC, header, asize, 0);
 		next = NEXT_H(header);
 		PUT(next, PACK(csize - asize, 1, 0));
 		PUT(TO_FTRP(next), PACK(csize - asize, 1, 0));
@@ -715,7 +1737,9 @@ place(void *p, size_t asize)
 	/* remain size is not enough, do not place*/
 	else 
 	{
+		PROBE(place_whole++);
 		PUT(header, PACK(csize, prev_alloc, 1));
+		EVLOG(MM_EV_ALLOC, header, csize, 0);
 		next = NEXT_H(header);
 		uintptr_t value = GET(next) | 0x2;
 		PUT(next, value);
@@ -729,78 +1753,149 @@ place(void *p, size_t asize)
  *   None.
  *
  * Effects:
- *   Find a fit for a block with "asize" bytes.  Returns that block's address
- *   or NULL if no suitable block was found. 
+ *   Find a fit for a block with "asize" bytes in the first class that has
+ *   one in the block's region, and place the block there.  Returns that
+ *   block's address or NULL if no suitable block was found. 
  */
 static void *
 find_fit(size_t asize)
 {
+	void *p;
+	int index, region = (nregions > 1 && asize >= LARGE_SIZE);
 
-	int index = get_list_index(asize);
-	void *p = freelists[index];
-
-	/* check the best fit list first*/
-	if(p != NULL)
-	{
-		
-		/* if the size is fit, place the block and return
-		   the payload pointer*/
-		if(asize <= GET_SIZE(p))
-		{
-
+	PROBE(fit_calls++);
+	for (index = get_list_index(asize); index < SEGLISTCOUNT; index++) {
+		PROBE(fit_classes++);
+		if ((p = search_list(index, asize, region)) != NULL) {
 			p = place(p, asize);
-			return TO_BLKP(p);
-		}
-			
-
-		p = (void*)GET_NEXT(p);
-		while( p != freelists[index])
-		{
-			if (!GET_ALLOC(p) && asize <= GET_SIZE(p))
-			{
-				p = place(p, asize);
-				return (TO_BLKP(p));
-			}
-			p = (void*)GET_NEXT(p);
+			return (TO_BLKP(p));
 		}
 	}
 
-	index ++;
+	/* No fit was found. */
+	return (NULL);
+}
 
-	/* Search in the rest free lists */
-	for (;index < SEGLISTCOUNT; index ++) 
-	{
+/*
+ * Requires:
+ *   "alignment" is a power of two greater than DSIZE.
+ *
+ * Effects:
+ *   Returns how far into the block "p" an aligned block can start: 0 if
+ *   its payload is aligned already, and otherwise far enough in to leave
+ *   room in front for a free block of the minimum size.
+ */
+static size_t
+align_lead(void *p, size_t alignment)
+{
+	uintptr_t payload = (uintptr_t)p + WSIZE;
 
-		/* if the size is fit, place the block and return
-		   the payload pointer*/	
-		void *p = freelists[index];
-		if(p == NULL)
-			continue;
-		if(asize <= GET_SIZE(p))
-		{
+	if (payload % alignment == 0)
+		return (0);
+	return (((payload + 2 * DSIZE + alignment - 1) &
+	    ~(uintptr_t)(alignment - 1)) - payload);
+}
 
-			p = place(p, asize);
-			return TO_BLKP(p);
-		}
+/*
+ * Requires:
+ *   "alignment" is a power of two greater than DSIZE.
+ *
+ * Effects:
+ *   Find the first free block, in the classes from that of "asize" on,
+ *   that holds a block of "asize" bytes with an aligned payload, take it
+ *   off its list and mark it allocated.  Returns its header, or NULL if
+ *   there is none.
+ */
+static void *
+find_aligned_fit(size_t alignment, size_t asize)
+{
+	int index, region = (nregions > 1 && asize >= LARGE_SIZE);
+	char *p;
 
-		p = (void*)GET_NEXT(p);
-		while( p != freelists[index])
-		{
-			if (!GET_ALLOC(p) && asize <= GET_SIZE(p))
-			{
-				p = place(p, asize);
-				return (TO_BLKP(p));
+	for (index = get_list_index(asize); index < SEGLISTCOUNT; index++) {
+		if ((p = (char *)freelists[region][index]) == NULL)
+			continue;
+		do {
+			if (align_lead(p, alignment) + asize <= GET_SIZE(p)) {
+				remove_free_block(p, index);
+				PUT(p, PACK(GET_SIZE(p), GET_PRE_ALLOC(p), 1));
+				PUT(NEXT_H(p), GET(NEXT_H(p)) | 0x2);
+				return (p);
 			}
-
-			p = (void*)GET_NEXT(p);
-		}	
+			p = (char *)GET_NEXT(p);
+		} while (p != (char *)freelists[region][index]);
 	}
-
-	/* No fit was found. */
 	return (NULL);
 }
 
+/*
+ * Requires:
+ *   index is a valid free list index
+ *
+ * Effects:
+ *   Search the list index of "region" for a block of at least "asize"
+ *   bytes, looking at up to fit_search blocks that are big enough, or
+ *   until one is exactly "asize" bytes.  Returns the smallest of those
+ *   blocks, or NULL if the list has none.
+ */
+static void *
+search_list(int index, size_t asize, int region)
+{
+	void *p = freelists[region][index], *best = NULL;
+	unsigned int fits = 0;
+
+	if (p == NULL)
+		return (NULL);
+	do {
+		PROBE(fit_visited++);
+		if (asize <= GET_SIZE(p)) {
+			if (best == NULL || GET_SIZE(p) < GET_SIZE(best))
+				best = p;
+			if (++fits >= fit_search || GET_SIZE(p) == asize)
+				break;
+		}
+		p = (void *)GET_NEXT(p);
+	} while (p != freelists[region][index]);
+	return (best);
+}
+
+#ifdef MM_EVLOG
+/*
+ * Requires:
+ *   "header" is the address of a block header in the heap, or NULL.
+ *
+ * Effects:
+ *   Append an event to the ring, flushing the ring first if it is full and
+ *   a file descriptor is attached, or else dropping the oldest event.  An
+ *   op made inside another op is not recorded.
+ */
+static void
+evlog_put(int type, void *header, size_t size, int aux)
+{
+	mm_event_t *e;
 
+	if (type >= MM_EV_MALLOC && type <= MM_EV_MEMALIGN) {
+		if (evlog_depth > 0)
+			return;
+		evlog_op++;
+	}
+	if (evlog_count == MM_EVLOG_SIZE) {
+		mm_evlog_flush();
+		if (evlog_count == MM_EVLOG_SIZE) {
+			evlog_start = (evlog_start + 1) % MM_EVLOG_SIZE;
+			evlog_count--;
+		}
+	}
+	e = &evlog[(evlog_start + evlog_count++) % MM_EVLOG_SIZE];
+	e->op = evlog_op;
+	e->type = type;
+	e->cls = (type >= MM_EV_ALLOC) ? get_list_index(size) : 0;
+	e->aux = aux;
+	e->addr = (header != NULL) ?
+	    (uint64_t)((char *)header - (char *)mem_heap_lo()) : 0;
+	e->size = size;
+}
+#endif
 
 /* 
  * The remaining routines are heap consistency checker routines. 
@@ -903,3 +1998,304 @@ printblock(void *p)
 	printf("the alloc flag is: %d\n", alloc);
 	printf("the prev alloc flag is: %d\n", palloc);
 }
+
+/*
+ * Requires:
+ *   "region" is a region in use.
+ *
+ * Effects:
+ *   Returns the address of the epilogue header of "region".
+ */
+static char *
+region_end(int region)
+{
+
+	/* Region 1's epilogue lies just before its list heads. */
+	if (region == 1)
+		return ((char *)freelists[1] - WSIZE);
+	return ((char *)mem_region_hi(region) + 1 - WSIZE);
+}
+
+/*
+ * Requires:
+ *   None.
+ *
+ * Effects:
+ *   Returns true if "p" could be the header of a block: it lies between
+ *   the first block and the epilogue of a region, its payload is aligned,
+ *   and its size is a multiple of the alignment that ends at or before
+ *   the epilogue.
+ */
+static bool
+valid_header(void *p)
+{
+	char *epilogue = region_end(REGION_OF(p));
+	size_t size;
+
+	if ((char *)p < heap_listp || (char *)p >= epilogue ||
+	    ((uintptr_t)p + WSIZE) % DSIZE != 0)
+		return (false);
+	size = GET_SIZE(p);
+	return (size >= 2 * DSIZE && size <= (size_t)(epilogue - (char *)p));
+}
+
+/*
+ * Requires:
+ *   "p" is a valid header of a free block.
+ *
+ * Effects:
+ *   Check the free block "p" against its footer and its free list: both
+ *   of its links must lead to free blocks of the same class that link back
+ *   to it.  The top block must instead end region 0, and no other free
+ *   block may.  Returns the number of problems found.
+ */
+static int
+check_free_block(void *p)
+{
+	int index = get_list_index(GET_SIZE(p));
+	void *prev = (void *)GET_PREV(p);
+	void *next = (void *)GET_NEXT(p);
+	int errors = 0;
+
+	if (GET_SIZE(TO_FTRP(p)) != GET_SIZE(p) || GET_ALLOC(TO_FTRP(p))) {
+		printf("Error: free block %p: footer does not match header\n",
+		    p);
+		errors++;
+	}
+	if ((p == top[REGION_OF(p)]) !=
+	    (GET_SIZE(NEXT_H(p)) == 0 && !REGION_OF(p))) {
+		printf("Error: free block %p: %s\n", p,
+		    (p == top[REGION_OF(p)]) ?
+		    "the top block does not end its region" :
+		    "ends its region, but is not the top block");
+		return (errors + 1);
+	}
+	if (p == top[REGION_OF(p)])
+		return (errors);
+	if (freelists[REGION_OF(p)][index] == NULL) {
+		printf("Error: free block %p: its list %d is empty\n", p,
+		    index);
+		return (errors + 1);
+	}
+	if (!valid_header(prev) || GET_ALLOC(prev) ||
+	    get_list_index(GET_SIZE(prev)) != index ||
+	    (void *)GET_NEXT(prev) != p) {
+		printf("Error: free block %p: bad prev link %p in list %d\n",
+		    p, prev, index);
+		errors++;
+	}
+	if (!valid_header(next) || GET_ALLOC(next) ||
+	    get_list_index(GET_SIZE(next)) != index ||
+	    (void *)GET_PREV(next) != p) {
+		printf("Error: free block %p: bad next link %p in list %d\n",
+		    p, next, index);
+		errors++;
+	}
+	return (errors);
+}
+
+/*
+ * Requires:
+ *   None.
+ *
+ * Effects:
+ *   Check the block "p" and its neighbors: the prev_alloc bits on both
+ *   sides, and the footer and list links of each that is free.  A
+ *   prev_alloc bit may still be set after the previous block was freed
+ *   without coalescing, so only a clear bit is checked against the
+ *   previous block.  Returns the number of problems found.
+ */
+static int
+check_around(void *p)
+{
+	char *epilogue = region_end(REGION_OF(p));
+	void *next, *prev;
+	int errors = 0;
+
+	if (!valid_header(p)) {
+		printf("Error: %p is not a valid block header\n", p);
+		return (1);
+	}
+	if (!GET_ALLOC(p))
+		errors += check_free_block(p);
+
+	next = NEXT_H(p);
+	if ((char *)next != epilogue && !valid_header(next)) {
+		printf("Error: block %p: bad next block %p\n", p, next);
+		errors++;
+	} else if (GET_ALLOC(p) && !GET_PRE_ALLOC(next)) {
+		printf("Error: block %p: next block %p says it is free\n", p,
+		    next);
+		errors++;
+	} else if ((char *)next != epilogue && !GET_ALLOC(next))
+		errors += check_free_block(next);
+
+	if (!GET_PRE_ALLOC(p)) {
+		prev = PREV_H(p);
+		if (!valid_header(prev) || GET_ALLOC(prev) ||
+		    NEXT_H(prev) != p) {
+			printf("Error: block %p: bad free previous block %p\n",
+			    p, prev);
+			errors++;
+		} else
+			errors += check_free_block(prev);
+	}
+	return (errors);
+}
+
+/*
+ * Requires:
+ *   mm_check_op has been called after every op since mm_init.
+ *
+ * Effects:
+ *   Check the blocks that the op since the last call touched, with their
+ *   neighbors and their free list links.  Returns the number of problems
+ *   found, after printing them.
+ */
+int
+mm_check_op(void)
+{
+	unsigned int i, n = MIN(ntouched, NTOUCHED);
+	int errors = 0;
+
+	for (i = 0; i < n; i++)
+		errors += check_around(touched[i]);
+	ntouched = 0;
+	return (errors);
+}
+
+/*
+ * Requires:
+ *   None.
+ *
+ * Effects:
+ *   Walk the whole heap, every free list and every fast bin, and cross-
+ *   check them: every block must be well formed, every free block must be
+ *   on the list of its class, every block on a list must be a free block
+ *   in the heap and in order if the lists are kept in address order,
+ *   every block in a fast bin must be of the bin's size, and the counters
+ *   must agree.  Returns the number of problems found,
+ *   after printing them.
+ */
+int
+mm_check_heap(void)
+{
+	char *epilogue;
+	size_t blocks[SEGLISTCOUNT], listed;
+	uintptr_t sums[SEGLISTCOUNT], sum;
+	int errors = 0, index, prev_alloc, region;
+	char *p, *last, *head;
+
+	memset(blocks, 0, sizeof(blocks));
+	memset(sums, 0, sizeof(sums));
+
+	/* Walk each region, tallying the free blocks of each class. */
+	for (region = 0; region < nregions; region++) {
+		epilogue = region_end(region);
+		prev_alloc = 1;
+		last = NULL;
+		for (p = first_block[region]; p != epilogue; p = NEXT_H(p)) {
+			if (!valid_header(p)) {
+				printf("Error: heap walk reached a bad header "
+				    "at %p\n", p);
+				return (errors + 1);
+			}
+			if (prev_alloc && !GET_PRE_ALLOC(p)) {
+				printf("Error: block %p: says the allocated "
+				    "block before it is free\n", p);
+				errors++;
+			}
+			if (!GET_ALLOC(p) && p != top[region]) {
+				if (GET_SIZE(TO_FTRP(p)) != GET_SIZE(p) ||
+				    GET_ALLOC(TO_FTRP(p))) {
+					printf("Error: free block %p: footer "
+					    "does not match header\n", p);
+					errors++;
+				}
+				index = get_list_index(GET_SIZE(p));
+				blocks[index]++;
+				sums[index] += (uintptr_t)p;
+			}
+			prev_alloc = GET_ALLOC(p);
+			last = p;
+		}
+		if (GET(epilogue) != PACK(0, GET_PRE_ALLOC(epilogue), 1)) {
+			printf("Error: region %d: bad epilogue header\n",
+			    region);
+			errors++;
+		}
+		if (!prev_alloc && last != top[region] && region == 0) {
+			printf("Error: region %d ends in a free block that is "
+			    "not its top block\n", region);
+			errors++;
+		} else if (top[region] != NULL &&
+		    (last != top[region] || GET_ALLOC(top[region]))) {
+			printf("Error: the top block %p is not a free block "
+			    "that ends region %d\n", top[region], region);
+			errors++;
+		}
+	}
+
+	/* Walk each class's lists, which must hold exactly those free blocks,
+	   each in its own region. */
+	for (index = 0; index < SEGLISTCOUNT; index++) {
+		listed = 0;
+		sum = 0;
+		for (region = 0; region < nregions; region++) {
+			if ((head = (char *)freelists[region][index]) == NULL)
+				continue;
+			p = head;
+			do {
+				if (!valid_header(p) || GET_ALLOC(p) ||
+				    REGION_OF(p) != region ||
+				    get_list_index(GET_SIZE(p)) != index ||
+				    (char *)GET_PREV(GET_NEXT(p)) != p ||
+				    (list_order == MM_LIST_ADDRESS &&
+				    (char *)GET_NEXT(p) != head &&
+				    (char *)GET_NEXT(p) < p)) {
+					printf("Error: list %d: bad block %p\n",
+					    index, p);
+					return (errors + 1);
+				}
+				listed++;
+				sum += (uintptr_t)p;
+				p = (char *)GET_NEXT(p);
+			} while (p != head && listed <= blocks[index]);
+		}
+		if (listed != blocks[index] || sum != sums[index]) {
+			printf("Error: list %d holds %zu blocks, but the heap "
+			    "has %zu free blocks of its class\n", index,
+			    listed, blocks[index]);
+			errors++;
+		}
+		if (listed != counters.class_blocks[index]) {
+			printf("Error: list %d holds %zu blocks, but the "
+			    "counters say %zu\n", index, listed,
+			    counters.class_blocks[index]);
+			errors++;
+		}
+	}
+
+	/* Walk each fast bin, which holds blocks of its exact size. */
+	sum = 0;
+	for (index = 0; index < NFASTBINS; index++) {
+		listed = 0;
+		for (p = fastbins[index]; p != NULL;
+		    p = (char *)GET(p + WSIZE)) {
+			if (!valid_header(p) || !GET_ALLOC(p) ||
+			    get_list_index(GET_SIZE(p)) != index ||
+			    ++listed > mem_heapsize() / GET_SIZE(p)) {
+				printf("Error: fast bin %d: bad block %p\n",
+				    index, p);
+				return (errors + 1);
+			}
+			sum += GET_SIZE(p);
+		}
+	}
+	if (sum != counters.fast_bytes) {
+		printf("Error: the fast bins hold %zu bytes, but the counters "
+		    "say %zu\n", (size_t)sum, counters.fast_bytes);
+		errors++;
+	}
+	return (errors);
+}
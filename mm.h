@@ -2,10 +2,203 @@
  * The public interface to the students' memory allocator.
  */
 
+#include <stdint.h>
+
 int	 mm_init(void);
 void	*mm_malloc(size_t size);
 void	 mm_free(void *ptr);
 void	*mm_realloc(void *ptr, size_t size);
+void	*mm_memalign(size_t alignment, size_t size);
+size_t	 mm_usable_size(void *ptr);
+
+/*
+ * The size classes of the allocator's segregated free lists.  get_size
+ * rounds a payload size up to a block size, and get_list_index maps a
+ * block size to its class, 0 through MM_NCLASSES - 1.
+ */
+#define	MM_NCLASSES	19
+
+size_t	 get_size(size_t size);
+int	 get_list_index(size_t size);
+
+/*
+ * A snapshot of the allocator's heap.  The counters are kept up to date as
+ * the allocator runs, so taking a snapshot does not walk the heap.
+ */
+typedef struct {
+	size_t	heap_size;	/* Bytes obtained from mem_sbrk. */
+	size_t	alloc_bytes;	/* Bytes in allocated blocks. */
+	size_t	free_bytes;	/* Bytes in free blocks. */
+	size_t	largest_free;	/* Size of the largest free block. */
+	size_t	top_size;	/* Bytes in the block that ends the heap, if
+				   free; counted in free_bytes. */
+	size_t	fast_bytes;	/* Bytes in freed blocks cached in the fast
+				   bins; counted in free_bytes. */
+	size_t	class_blocks[MM_NCLASSES]; /* Free blocks in each class. */
+	size_t	class_bytes[MM_NCLASSES];  /* Bytes in those blocks. */
+	size_t	sbrk_count;	/* Calls to mem_sbrk that grew the heap. */
+	size_t	coalesce_count;	/* Merges of a block with a free neighbor. */
+	size_t	split_count;	/* Free blocks split to place a block. */
+} mm_stats_t;
+
+void	 mm_get_stats(mm_stats_t *stats);
+
+/*
+ * The heap growth policy.  When no free block fits, the heap grows by the
+ * current extension size, or by more if the block needs it.  That size
+ * starts at min_chunk and doubles whenever two extensions come within
+ * "window" ops (mallocs and reallocs) of each other, and halves whenever
+ * they come more than four times as far apart.  It never exceeds
+ * max_chunk or heap_percent of the heap.  min_chunk == max_chunk, or a
+ * window of 0, grows the heap by a fixed amount.  mm_set_growth_policy
+ * takes effect at the next mm_init; NULL restores the default.
+ */
+typedef struct {
+	size_t	min_chunk;	/* Smallest extension, in bytes. */
+	size_t	max_chunk;	/* Largest extension, in bytes. */
+	unsigned int heap_percent; /* Largest extension, in % of the heap. */
+	unsigned int window;	/* Ops between extensions that count as
+				   growing fast. */
+} mm_growth_t;
+
+void	 mm_set_growth_policy(const mm_growth_t *policy);
+
+/*
+ * The order of the free lists, which find_fit searches first to last:
+ * oldest free block first (FIFO, the default), newest first (LIFO), or
+ * lowest address first.  mm_set_list_policy takes effect at the next
+ * mm_init.
+ */
+#define	MM_LIST_FIFO		0
+#define	MM_LIST_LIFO		1
+#define	MM_LIST_ADDRESS		2
+
+void	 mm_set_list_policy(int policy);
+
+/*
+ * Bounded best fit.  find_fit searches the first class that has a block
+ * that fits, and takes the first such block by default.  With
+ * mm_set_fit_search(k), it looks at up to k blocks that fit, stopping
+ * early at an exact fit, and takes the smallest: a few more probes per
+ * malloc, for less splitting and a smaller heap.  Takes effect at once.
+ */
+void	 mm_set_fit_search(unsigned int k);
+
+/*
+ * Heap regions.  With mm_set_regions(1), blocks of 1040 bytes or more on
+ * a 64-bit machine (the classes from 7 on) are carved from a region of
+ * the heap of their own, which grows independently of the region for
+ * smaller blocks, so that small long-lived blocks do not pin large free
+ * blocks apart.  Off by default; takes effect at the next mm_init.
+ */
+void	 mm_set_regions(int on);
+
+/*
+ * Arenas, for blocks that all die together.  mm_arena_alloc carves blocks
+ * out of chunks that the arena gets from mm_malloc by bumping a pointer,
+ * and the blocks cannot be freed one at a time.  Instead, mm_arena_reset
+ * frees all of them at once by returning the chunks to the heap as a few
+ * large blocks, keeping only the newest chunk for the arena's next use.
+ * mm_arena_destroy frees that chunk and the arena as well.  A chunk_size
+ * of 0 picks MM_ARENA_CHUNK.  Blocks are aligned as mm_malloc's are.
+ */
+#define	MM_ARENA_CHUNK	65536	/* Default bytes per chunk. */
+
+typedef struct mm_arena mm_arena_t;
+
+mm_arena_t *mm_arena_create(size_t chunk_size);
+void	*mm_arena_alloc(mm_arena_t *arena, size_t size);
+void	 mm_arena_reset(mm_arena_t *arena);
+void	 mm_arena_destroy(mm_arena_t *arena);
+
+/*
+ * Counts of the work done on the allocator's hot paths.  The probes that
+ * collect them compile to nothing unless mm.c is built with MM_PROBES
+ * defined ("make PROBES=1"), in which case mm_get_probes returns 1.
+ * coalesce and coalesce_declined are indexed by which neighbors were free:
+ * MM_COALESCE_NONE, _NEXT, _PREV or _BOTH.
+ */
+#define	MM_COALESCE_NONE	0
+#define	MM_COALESCE_NEXT	1
+#define	MM_COALESCE_PREV	2
+#define	MM_COALESCE_BOTH	3
+
+typedef struct {
+	size_t	fit_calls;	/* Calls to find_fit. */
+	size_t	fit_classes;	/* Free lists find_fit looked in. */
+	size_t	fit_visited;	/* Free blocks find_fit looked at. */
+	size_t	place_front;	/* Blocks placed at the front of a split... */
+	size_t	place_back;	/* ... at the back of a split... */
+	size_t	place_whole;	/* ... or in a whole free block. */
+	size_t	coalesce[4];	/* Calls to coalesce, by case... */
+	size_t	coalesce_declined[4]; /* ... that kept a small block apart. */
+	size_t	extend_calls;	/* Heap extensions. */
+} mm_probes_t;
+
+int	 mm_get_probes(mm_probes_t *probes);
+
+/*
+ * The allocator's event log, built into mm.c when MM_EVLOG is defined
+ * ("make EVLOG=1").  Each event records one decision, with the address
+ * of the block header as an offset from the start of the heap.  Events
+ * collect in a ring buffer.  Once a file descriptor is attached they are
+ * written to it whenever the ring fills, after a header of MM_EVLOG_MAGIC
+ * and the size of an event; otherwise the ring keeps only the most
+ * recent events.  mm_init starts a new run, with op 0.  An op is a call
+ * to mm_malloc, mm_free, mm_realloc or mm_memalign from outside mm.c.
+ */
+#define	MM_EVLOG_MAGIC	"mmevlog1"	/* 8 bytes, no terminator */
+#define	MM_EVLOG_SIZE	65536		/* Events in the ring buffer. */
+
+#define	MM_EV_INIT	0	/* mm_init created the heap. */
+#define	MM_EV_MALLOC	1	/* An op: size is the request... */
+#define	MM_EV_FREE	2
+#define	MM_EV_REALLOC	3
+#define	MM_EV_MEMALIGN	4	/* ... and aux is log2 of the alignment. */
+#define	MM_EV_EXTEND	5	/* The heap grew by size bytes at addr. */
+#define	MM_EV_ALLOC	6	/* The block at addr is now allocated. */
+#define	MM_EV_RELEASE	7	/* The block at addr is now free. */
+#define	MM_EV_INSERT	8	/* A free block entered list cls... */
+#define	MM_EV_REMOVE	9	/* ... or left it. */
+#define	MM_EV_SPLIT	10	/* A free block was split; aux says how. */
+#define	MM_EV_COALESCE	11	/* Blocks merged into the block at addr. */
+#define	MM_EV_RESIZE	12	/* mm_realloc's path; aux says which. */
+#define	MM_EV_NTYPES	13
+
+/* aux of MM_EV_SPLIT: where place put the allocated block. */
+#define	MM_SPLIT_FRONT	0
+#define	MM_SPLIT_BACK	1
+#define	MM_SPLIT_ALIGN	2	/* mm_memalign freed the lead. */
+
+/* aux of MM_EV_COALESCE is an MM_COALESCE_* case. */
+
+/* aux of MM_EV_RESIZE: how mm_realloc made room. */
+#define	MM_RESIZE_INPLACE	0	/* The block was big enough. */
+#define	MM_RESIZE_NEXT		1	/* Merged with the next block. */
+#define	MM_RESIZE_PREV		2	/* Merged with the previous block. */
+#define	MM_RESIZE_BOTH		3	/* Merged with both. */
+#define	MM_RESIZE_MOVE		4	/* Moved to a new block. */
+
+typedef struct {
+	uint32_t op;		/* Ops since mm_init. */
+	uint8_t	type;		/* MM_EV_*. */
+	uint8_t	cls;		/* Size class of the block. */
+	uint16_t aux;		/* Depends on the type. */
+	uint64_t addr;		/* Block header's offset in the heap. */
+	uint64_t size;		/* Block (or requested) size. */
+} mm_event_t;
+
+/*
+ * Heap checking.  Called after every op, mm_check_op checks just the
+ * blocks that the op touched, with their neighbors and free list links.
+ * mm_check_heap walks the whole heap and every free list and cross-checks
+ * them.  Each returns the number of problems found, after printing them.
+ */
+int	 mm_check_op(void);
+int	 mm_check_heap(void);
+
+int	 mm_evlog_attach(int fd);
+void	 mm_evlog_flush(void);
 
 /*
  * Students work in teams of one or two.  Teams enter their team name, personal
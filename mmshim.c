@@ -0,0 +1,240 @@
+/*
+ * mmshim.c - The standard allocation interface on top of mm.c, for
+ *            building libmm.so, a drop-in malloc replacement:
+ *
+ *                unix> LD_PRELOAD=./libmm.so <program>
+ *
+ *            mm.c is not thread safe, so every call holds one process-
+ *            wide lock. The heap is set up on the first call, since that
+ *            may come from the dynamic linker before any constructor
+ *            runs. Fork handlers hold the lock across fork(), so the
+ *            child never inherits it locked by a thread that no longer
+ *            exists.
+ *
+ *            Only the functions below are exported; mm.c and
+ *            memlib_mmap.c are built with hidden visibility.
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "memlib.h"
+#include "mm.h"
+
+#define EXPORT __attribute__((visibility("default")))
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static int initialized = 0;  /* set once mm_init has succeeded */
+
+/*
+ * mm_ready - Set up the heap on the first call. Returns 0 on success,
+ *     or -1 if the heap could not be created. The caller holds lock.
+ */
+static int mm_ready(void)
+{
+    if (!initialized) {
+	mem_init();
+	if (mm_init() < 0)
+	    return -1;
+	initialized = 1;
+    }
+    return 0;
+}
+
+/*
+ * The fork handlers: hold the lock across fork(), then release it in
+ * both the parent and the child
+ */
+static void prepare_fork(void)
+{
+    pthread_mutex_lock(&lock);
+}
+
+static void parent_fork(void)
+{
+    pthread_mutex_unlock(&lock);
+}
+
+static void child_fork(void)
+{
+    pthread_mutex_init(&lock, NULL);
+}
+
+/*
+ * register_fork_handlers - Registered outside of any allocation, since
+ *     pthread_atfork may itself allocate
+ */
+__attribute__((constructor))
+static void register_fork_handlers(void)
+{
+    pthread_atfork(prepare_fork, parent_fork, child_fork);
+}
+
+EXPORT void *malloc(size_t size)
+{
+    void *p = NULL;
+
+    /* malloc(0) must return a pointer that can be passed to free */
+    if (size == 0)
+	size = 1;
+    pthread_mutex_lock(&lock);
+    if (mm_ready() == 0)
+	p = mm_malloc(size);
+    pthread_mutex_unlock(&lock);
+    if (p == NULL)
+	errno = ENOMEM;
+    return p;
+}
+
+EXPORT void free(void *ptr)
+{
+    if (ptr == NULL)
+	return;
+    pthread_mutex_lock(&lock);
+    mm_free(ptr);
+    pthread_mutex_unlock(&lock);
+}
+
+EXPORT void *realloc(void *ptr, size_t size)
+{
+    void *p = NULL;
+
+    if (ptr == NULL)
+	return malloc(size);
+    pthread_mutex_lock(&lock);
+    p = mm_realloc(ptr, size);
+    pthread_mutex_unlock(&lock);
+    if (p == NULL && size != 0)
+	errno = ENOMEM;
+    return p;
+}
+
+EXPORT void *calloc(size_t nmemb, size_t size)
+{
+    void *p;
+
+    if (size != 0 && nmemb > SIZE_MAX / size) {
+	errno = ENOMEM;
+	return NULL;
+    }
+    if ((p = malloc(nmemb * size)) != NULL)
+	memset(p, 0, nmemb * size);
+    return p;
+}
+
+EXPORT int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    void *p = NULL;
+
+    if (alignment < sizeof(void *) || (alignment & (alignment - 1)) != 0)
+	return EINVAL;
+    if (size == 0)
+	size = 1;
+    pthread_mutex_lock(&lock);
+    if (mm_ready() == 0)
+	p = mm_memalign(alignment, size);
+    pthread_mutex_unlock(&lock);
+    if (p == NULL)
+	return ENOMEM;
+    *memptr = p;
+    return 0;
+}
+
+/*
+ * The other aligned allocators are exported too, so that none of a
+ * program's blocks come from libc's heap and are then passed to free
+ */
+EXPORT void *aligned_alloc(size_t alignment, size_t size)
+{
+    void *p;
+    int err;
+
+    if ((err = posix_memalign(&p, alignment, size)) != 0) {
+	errno = err;
+	return NULL;
+    }
+    return p;
+}
+
+EXPORT void *memalign(size_t alignment, size_t size)
+{
+    return aligned_alloc(alignment < sizeof(void *) ? sizeof(void *) :
+			 alignment, size);
+}
+
+EXPORT void *valloc(size_t size)
+{
+    return aligned_alloc((size_t)getpagesize(), size);
+}
+
+EXPORT size_t malloc_usable_size(void *ptr)
+{
+    size_t size;
+
+    if (ptr == NULL)
+	return 0;
+    pthread_mutex_lock(&lock);
+    size = mm_usable_size(ptr);
+    pthread_mutex_unlock(&lock);
+    return size;
+}
+
+/*
+ * libmm_get_stats - mm_get_stats for a monitor in the same process, found
+ *     with dlsym(RTLD_DEFAULT, "libmm_get_stats")
+ */
+EXPORT void libmm_get_stats(mm_stats_t *stats)
+{
+    pthread_mutex_lock(&lock);
+    if (mm_ready() == 0)
+	mm_get_stats(stats);
+    else
+	memset(stats, 0, sizeof(*stats));
+    pthread_mutex_unlock(&lock);
+}
+
+/*
+ * The mm_arena_* functions, exported as libmm_arena_*
+ */
+EXPORT mm_arena_t *libmm_arena_create(size_t chunk_size)
+{
+    mm_arena_t *arena = NULL;
+
+    pthread_mutex_lock(&lock);
+    if (mm_ready() == 0)
+	arena = mm_arena_create(chunk_size);
+    pthread_mutex_unlock(&lock);
+    if (arena == NULL)
+	errno = ENOMEM;
+    return arena;
+}
+
+EXPORT void *libmm_arena_alloc(mm_arena_t *arena, size_t size)
+{
+    void *p;
+
+    pthread_mutex_lock(&lock);
+    p = mm_arena_alloc(arena, size);
+    pthread_mutex_unlock(&lock);
+    if (p == NULL && size != 0)
+	errno = ENOMEM;
+    return p;
+}
+
+EXPORT void libmm_arena_reset(mm_arena_t *arena)
+{
+    pthread_mutex_lock(&lock);
+    mm_arena_reset(arena);
+    pthread_mutex_unlock(&lock);
+}
+
+EXPORT void libmm_arena_destroy(mm_arena_t *arena)
+{
+    if (arena == NULL)
+	return;
+    pthread_mutex_lock(&lock);
+    mm_arena_destroy(arena);
+    pthread_mutex_unlock(&lock);
+}
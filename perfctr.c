@@ -0,0 +1,125 @@
+/*
+ * perfctr.c - Hardware performance counters via perf_event_open(2)
+ *
+ * Each event is opened on its own rather than as a group, so that an
+ * event the CPU or kernel does not support (or that is hidden inside a
+ * VM) does not take the others down with it. If the kernel multiplexes
+ * the counters, the counts are scaled by the fraction of the interval
+ * during which each event was actually scheduled.
+ */
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "perfctr.h"
+
+#define CACHE_EVENT(cache, op, result) \
+    ((cache) | ((op) << 8) | ((result) << 16))
+
+/* The type and config of each event */
+static const struct {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+} events[PERF_NEVENTS] = {
+    {"instr", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"L1D-miss", PERF_TYPE_HW_CACHE,
+     CACHE_EVENT(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+		 PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {"LLC-miss", PERF_TYPE_HW_CACHE,
+     CACHE_EVENT(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ,
+		 PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {"dTLB-miss", PERF_TYPE_HW_CACHE,
+     CACHE_EVENT(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ,
+		 PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {"br-miss", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES}
+};
+
+/* File descriptor of each event, or -1 if it is unavailable */
+static int fds[PERF_NEVENTS] = {-1, -1, -1, -1, -1, -1};
+
+/*
+ * perf_init - Open all of the events for the calling process, counting
+ *     user-mode execution only. Events already open (e.g., inherited
+ *     from a parent process) are closed first. Returns the number of
+ *     events opened.
+ */
+int perf_init(int verbose)
+{
+    struct perf_event_attr attr;
+    int e, n = 0;
+
+    for (e = 0; e < PERF_NEVENTS; e++) {
+	if (fds[e] >= 0)
+	    close(fds[e]);
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = events[e].type;
+	attr.config = events[e].config;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+	    PERF_FORMAT_TOTAL_TIME_RUNNING;
+	fds[e] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+	if (fds[e] < 0) {
+	    if (verbose)
+		printf("Performance counter %s unavailable: %s\n",
+		       events[e].name, strerror(errno));
+	    fds[e] = -1;
+	} else
+	    n++;
+    }
+    return n;
+}
+
+/*
+ * perf_start - Reset and enable all of the open events
+ */
+void perf_start(void)
+{
+    int e;
+
+    for (e = 0; e < PERF_NEVENTS; e++) {
+	if (fds[e] >= 0) {
+	    ioctl(fds[e], PERF_EVENT_IOC_RESET, 0);
+	    ioctl(fds[e], PERF_EVENT_IOC_ENABLE, 0);
+	}
+    }
+}
+
+/*
+ * perf_stop - Disable all of the open events and read their counts
+ */
+void perf_stop(perf_counts_t *c)
+{
+    uint64_t buf[3]; /* value, time enabled, time running */
+    int e;
+
+    for (e = 0; e < PERF_NEVENTS; e++)
+	if (fds[e] >= 0)
+	    ioctl(fds[e], PERF_EVENT_IOC_DISABLE, 0);
+
+    for (e = 0; e < PERF_NEVENTS; e++) {
+	c->valid[e] = 0;
+	c->count[e] = 0.0;
+	if (fds[e] < 0 || read(fds[e], buf, sizeof(buf)) != sizeof(buf) ||
+	    buf[2] == 0)
+	    continue;
+	c->valid[e] = 1;
+	c->count[e] = (double)buf[0] * ((double)buf[1] / (double)buf[2]);
+    }
+}
+
+/*
+ * perf_event_name - Return a short name for event e
+ */
+const char *perf_event_name(int e)
+{
+    return events[e].name;
+}
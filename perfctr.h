@@ -0,0 +1,30 @@
+/*
+ * perfctr.h - Hardware performance counters via perf_event_open(2)
+ */
+
+/* The events we count, in reporting order */
+#define PERF_INSTRUCTIONS  0
+#define PERF_CYCLES        1
+#define PERF_L1D_MISSES    2
+#define PERF_LLC_MISSES    3
+#define PERF_DTLB_MISSES   4
+#define PERF_BRANCH_MISSES 5
+#define PERF_NEVENTS       6
+
+/* Event counts for one measured interval */
+typedef struct {
+    double count[PERF_NEVENTS]; /* counts, scaled for multiplexing */
+    int valid[PERF_NEVENTS];    /* was the event available? */
+} perf_counts_t;
+
+/* Open the events for this process. Returns the number available */
+int perf_init(int verbose);
+
+/* Start counting */
+void perf_start(void);
+
+/* Stop counting, and store the counts since perf_start in c */
+void perf_stop(perf_counts_t *c);
+
+/* Return a short name for event e */
+const char *perf_event_name(int e);
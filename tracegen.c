@@ -0,0 +1,460 @@
+/*
+ * tracegen.c - Generate synthetic trace files for the malloc driver
+ *
+ * A workload is described by key=value arguments: the distribution of
+ * request sizes, the distribution of object lifetimes (in allocation
+ * steps), the fraction of objects that are grown by realloc chains, a
+ * cap on the live set, and a seed. Each step allocates one object,
+ * after first emitting every free and realloc that has come due, so a
+ * fixed lifetime yields producer/consumer (FIFO) order. All objects
+ * still live at the end are freed, so the traces are balanced like
+ * the course's "-bal" traces.
+ *
+ * The output is a .rep file whose header (suggested heap size, number
+ * of ids, number of ops, weight) matches what read_trace expects.
+ */
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* A distribution of sizes or lifetimes, parsed from "kind:arg:..." */
+#define DIST_FIXED    0   /* fixed:n */
+#define DIST_UNIFORM  1   /* uniform:lo:hi */
+#define DIST_POW      2   /* pow:alpha:lo:hi, p(x) ~ x^-alpha */
+#define DIST_EXP      3   /* exp:mean */
+
+typedef struct {
+    int kind;
+    double a, lo, hi;
+} dist_t;
+
+/* Events pending for live objects, ordered by due step */
+#define EV_FREE     0
+#define EV_REALLOC  1
+
+typedef struct {
+    unsigned long due;  /* step at which the event happens */
+    unsigned long seq;  /* breaks ties in the order events were queued */
+    int id;             /* object the event applies to */
+    int type;           /* EV_FREE or EV_REALLOC */
+} event_t;
+
+/* One trace op, buffered until the header can be written */
+typedef struct {
+    char type;          /* 'a', 'r' or 'f' */
+    int id;
+    size_t size;
+} op_t;
+
+/* The state of one object */
+typedef struct {
+    size_t size;        /* current size in bytes */
+    int reallocs;       /* reallocs left in its growth chain */
+    unsigned long gap;  /* steps between the reallocs of its chain */
+    int live;
+} obj_t;
+
+/* Workload parameters, set by the key=value arguments */
+static unsigned long nallocs = 10000;   /* allocations to generate */
+static unsigned long long seed = 1;
+static dist_t size_dist = {DIST_UNIFORM, 0, 1, 4096};
+static dist_t life_dist = {DIST_EXP, 100, 0, 0};
+static double long_frac = 0.0;          /* fraction of long-lived objects */
+static dist_t long_dist = {DIST_EXP, 10000, 0, 0};
+static double realloc_frac = 0.0;       /* fraction of objects grown */
+static int chain = 4;                   /* reallocs per growth chain */
+static double growth = 2.0;             /* growth factor per realloc */
+static size_t max_size = 1 << 20;       /* no request is larger */
+static size_t max_live = 0;             /* cap on live bytes (0 = none) */
+static char *outfile = NULL;
+
+/* Generator state */
+static uint64_t rng_state;
+static event_t *events;
+static unsigned long nevents, events_cap, next_seq;
+static op_t *ops;
+static unsigned long nops, ops_cap;
+static obj_t *objs;
+static size_t live_bytes, peak_bytes;
+
+static void usage(void);
+static void gen_error(char *msg, char *arg);
+
+/*
+ * rng_next - Return a uniformly distributed 64-bit value (xorshift64*),
+ *     so that a seed gives the same trace on every platform
+ */
+static uint64_t rng_next(void)
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+/*
+ * rng_unit - Return a uniformly distributed double in (0, 1)
+ */
+static double rng_unit(void)
+{
+    return ((rng_next() >> 11) + 0.5) / 9007199254740992.0;
+}
+
+/*
+ * sample - Draw a value from distribution d
+ */
+static double sample(const dist_t *d)
+{
+    double u = rng_unit(), e;
+
+    switch (d->kind) {
+    case DIST_FIXED:
+	return d->a;
+    case DIST_UNIFORM:
+	return floor(d->lo + u * (d->hi - d->lo + 1));
+    case DIST_POW:
+	/* Invert the CDF of x^-alpha truncated to [lo, hi] */
+	if (fabs(d->a - 1.0) < 1e-9)
+	    return floor(d->lo * pow(d->hi / d->lo, u));
+	e = 1.0 - d->a;
+	return floor(pow(pow(d->lo, e) + u * (pow(d->hi, e) - pow(d->lo, e)),
+			 1.0 / e));
+    case DIST_EXP:
+	return floor(-d->a * log(u));
+    }
+    return 0.0;
+}
+
+/*
+ * parse_dist - Parse "kind:arg:..." into d
+ */
+static void parse_dist(char *s, dist_t *d)
+{
+    char *arg = strchr(s, ':');
+    int n = 0;
+    double v[3] = {0.0, 0.0, 0.0};
+
+    if (arg != NULL) {
+	*arg++ = '\0';
+	while (n < 3 && arg != NULL && *arg != '\0') {
+	    v[n++] = atof(arg);
+	    arg = strchr(arg, ':');
+	    if (arg != NULL)
+		arg++;
+	}
+    }
+    if (strcmp(s, "fixed") == 0 && n == 1)
+	*d = (dist_t){DIST_FIXED, v[0], 0, 0};
+    else if (strcmp(s, "uniform") == 0 && n == 2 && v[0] <= v[1])
+	*d = (dist_t){DIST_UNIFORM, 0, v[0], v[1]};
+    else if (strcmp(s, "pow") == 0 && n == 3 && v[1] >= 1 && v[1] <= v[2])
+	*d = (dist_t){DIST_POW, v[0], v[1], v[2]};
+    else if (strcmp(s, "exp") == 0 && n == 1)
+	*d = (dist_t){DIST_EXP, v[0], 0, 0};
+    else
+	gen_error("bad distribution", s);
+}
+
+/*
+ * draw_size - Draw a request size, clipped to [1, max_size]
+ */
+static size_t draw_size(void)
+{
+    double s = sample(&size_dist);
+
+    if (s < 1)
+	return 1;
+    if (s > max_size)
+	return max_size;
+    return (size_t)s;
+}
+
+/*
+ * push_event - Queue an event for object id at step due
+ */
+static void push_event(unsigned long due, int id, int type)
+{
+    unsigned long i, parent;
+    event_t ev = {due, next_seq++, id, type};
+
+    if (nevents == events_cap) {
+	events_cap = events_cap ? 2 * events_cap : 1024;
+	if ((events = realloc(events, events_cap * sizeof(event_t))) == NULL)
+	    gen_error("out of memory", NULL);
+    }
+    /* Sift up the binary min-heap */
+    for (i = nevents++; i > 0; i = parent) {
+	parent = (i - 1) / 2;
+	if (events[parent].due < ev.due ||
+	    (events[parent].due == ev.due && events[parent].seq < ev.seq))
+	    break;
+	events[i] = events[parent];
+    }
+    events[i] = ev;
+}
+
+/*
+ * pop_event - Remove the earliest event from the queue
+ */
+static event_t pop_event(void)
+{
+    event_t top = events[0], last = events[--nevents];
+    unsigned long i = 0, c;
+
+    /* Sift down the binary min-heap */
+    while ((c = 2 * i + 1) < nevents) {
+	if (c + 1 < nevents && (events[c + 1].due < events[c].due ||
+	    (events[c + 1].due == events[c].due &&
+	     events[c + 1].seq < events[c].seq)))
+	    c++;
+	if (last.due < events[c].due ||
+	    (last.due == events[c].due && last.seq < events[c].seq))
+	    break;
+	events[i] = events[c];
+	i = c;
+    }
+    if (nevents > 0)
+	events[i] = last;
+    return top;
+}
+
+/*
+ * emit - Append an op to the trace
+ */
+static void emit(char type, int id, size_t size)
+{
+    if (nops == ops_cap) {
+	ops_cap = ops_cap ? 2 * ops_cap : 4096;
+	if ((ops = realloc(ops, ops_cap * sizeof(op_t))) == NULL)
+	    gen_error("out of memory", NULL);
+    }
+    ops[nops].type = type;
+    ops[nops].id = id;
+    ops[nops].size = size;
+    nops++;
+}
+
+/*
+ * do_event - Emit the op for event ev, unless its object is already dead
+ */
+static void do_event(event_t ev, unsigned long step)
+{
+    obj_t *o = &objs[ev.id];
+    size_t size;
+
+    if (!o->live)
+	return;
+    if (ev.type == EV_FREE) {
+	emit('f', ev.id, 0);
+	live_bytes -= o->size;
+	o->live = 0;
+    } else {
+	/* Clip to [1, max_size] like draw_size: a realloc to 0 frees */
+	if (o->size * growth < 1)
+	    size = 1;
+	else if (o->size * growth > max_size)
+	    size = max_size;
+	else
+	    size = (size_t)(o->size * growth);
+	emit('r', ev.id, size);
+	live_bytes += size - o->size;
+	o->size = size;
+	if (--o->reallocs > 0)
+	    push_event(step + o->gap, ev.id, EV_REALLOC);
+    }
+}
+
+/*
+ * generate - Generate the whole trace into ops[]
+ */
+static void generate(void)
+{
+    unsigned long step, life, gap;
+    int id;
+    event_t ev;
+
+    if ((objs = calloc(nallocs, sizeof(obj_t))) == NULL)
+	gen_error("out of memory", NULL);
+    rng_state = seed * 0x9E3779B97F4A7C15ULL + 1;
+
+    for (step = 0; step < nallocs; step++) {
+	/* Everything that has come due happens before this allocation */
+	while (nevents > 0 && events[0].due <= step) {
+	    ev = pop_event();
+	    do_event(ev, step);
+	}
+
+	/* Allocate the next object and schedule its death */
+	id = (int)step;
+	objs[id].size = draw_size();
+	objs[id].live = 1;
+	if (long_frac > 0.0 && rng_unit() < long_frac)
+	    life = (unsigned long)sample(&long_dist);
+	else
+	    life = (unsigned long)sample(&life_dist);
+
+	/*
+	 * Respect the live-set cap by freeing the objects due to die
+	 * soonest. Growth steps popped on the way are dropped.
+	 */
+	while (max_live > 0 && live_bytes + objs[id].size > max_live &&
+	       nevents > 0) {
+	    ev = pop_event();
+	    if (ev.type == EV_FREE)
+		do_event(ev, step);
+	}
+	emit('a', id, objs[id].size);
+	live_bytes += objs[id].size;
+	push_event(step + 1 + life, id, EV_FREE);
+
+	/* Spread a growth chain evenly over the object's lifetime */
+	if (realloc_frac > 0.0 && chain > 0 && rng_unit() < realloc_frac) {
+	    gap = life / (chain + 1);
+	    if (gap > 0) {
+		objs[id].reallocs = chain;
+		objs[id].gap = gap;
+		push_event(step + 1 + gap, id, EV_REALLOC);
+	    }
+	}
+	if (live_bytes > peak_bytes)
+	    peak_bytes = live_bytes;
+    }
+
+    /* Free everything still live, in the order it would have died */
+    while (nevents > 0) {
+	ev = pop_event();
+	if (ev.type == EV_FREE)
+	    do_event(ev, step);
+    }
+}
+
+/*
+ * write_trace - Write the header and the ops to fp
+ */
+static void write_trace(FILE *fp)
+{
+    unsigned long i;
+
+    fprintf(fp, "%lu\n%lu\n%lu\n%d\n", (unsigned long)peak_bytes, nallocs,
+	    nops, 1);
+    for (i = 0; i < nops; i++) {
+	if (ops[i].type == 'f')
+	    fprintf(fp, "f %d\n", ops[i].id);
+	else
+	    fprintf(fp, "%c %d %lu\n", ops[i].type, ops[i].id,
+		    (unsigned long)ops[i].size);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    FILE *fp = stdout;
+    char *key, *val;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+	key = argv[i];
+	if (strcmp(key, "-h") == 0) {
+	    usage();
+	    exit(0);
+	}
+	if ((val = strchr(key, '=')) == NULL)
+	    gen_error("expected key=value", key);
+	*val++ = '\0';
+	if (strcmp(key, "ops") == 0)
+	    nallocs = strtoul(val, NULL, 0);
+	else if (strcmp(key, "seed") == 0)
+	    seed = strtoull(val, NULL, 0);
+	else if (strcmp(key, "size") == 0)
+	    parse_dist(val, &size_dist);
+	else if (strcmp(key, "maxsize") == 0)
+	    max_size = strtoul(val, NULL, 0);
+	else if (strcmp(key, "life") == 0)
+	    parse_dist(val, &life_dist);
+	else if (strcmp(key, "longfrac") == 0)
+	    long_frac = atof(val);
+	else if (strcmp(key, "longlife") == 0)
+	    parse_dist(val, &long_dist);
+	else if (strcmp(key, "realloc") == 0)
+	    realloc_frac = atof(val);
+	else if (strcmp(key, "chain") == 0)
+	    chain = atoi(val);
+	else if (strcmp(key, "growth") == 0)
+	    growth = atof(val);
+	else if (strcmp(key, "maxlive") == 0)
+	    max_live = strtoul(val, NULL, 0);
+	else if (strcmp(key, "out") == 0)
+	    outfile = val;
+	else
+	    gen_error("unknown key", key);
+    }
+    if (nallocs == 0 || nallocs > 0x7fffffff)
+	gen_error("ops must be between 1 and 2^31-1", NULL);
+    if (max_size == 0)
+	gen_error("maxsize must be at least 1", NULL);
+    if (!(long_frac >= 0 && long_frac <= 1))
+	gen_error("longfrac must be between 0 and 1", NULL);
+    if (!(realloc_frac >= 0 && realloc_frac <= 1))
+	gen_error("realloc must be between 0 and 1", NULL);
+    if (chain < 0)
+	gen_error("chain must not be negative", NULL);
+    if (!(growth > 0))
+	gen_error("growth must be positive", NULL);
+
+    generate();
+
+    if (outfile != NULL && (fp = fopen(outfile, "w")) == NULL)
+	gen_error(strerror(errno), outfile);
+    write_trace(fp);
+    if (fp != stdout)
+	fclose(fp);
+    return 0;
+}
+
+/*
+ * gen_error - Report an error and exit
+ */
+static void gen_error(char *msg, char *arg)
+{
+    if (arg != NULL)
+	fprintf(stderr, "tracegen: %s: %s\n", msg, arg);
+    else
+	fprintf(stderr, "tracegen: %s\n", msg);
+    exit(1);
+}
+
+/*
+ * usage - Explain the workload description
+ */
+static void usage(void)
+{
+    fprintf(stderr, "Usage: tracegen [key=value ...] [out=<file>]\n");
+    fprintf(stderr, "Distributions: fixed:n, uniform:lo:hi, "
+	    "pow:alpha:lo:hi, exp:mean\n");
+    fprintf(stderr, "\tops=<n>         Number of allocations "
+	    "(default 10000).\n");
+    fprintf(stderr, "\tseed=<n>        Random seed (default 1).\n");
+    fprintf(stderr, "\tsize=<dist>     Request sizes in bytes "
+	    "(default uniform:1:4096).\n");
+    fprintf(stderr, "\tmaxsize=<n>     Clip sizes, including realloc "
+	    "growth, to <n> bytes.\n");
+    fprintf(stderr, "\tlife=<dist>     Lifetimes in allocations "
+	    "(default exp:100).\n");
+    fprintf(stderr, "\t                fixed:n frees in FIFO order.\n");
+    fprintf(stderr, "\tlongfrac=<p>    Fraction of objects drawn from "
+	    "longlife instead.\n");
+    fprintf(stderr, "\tlonglife=<dist> Lifetimes of long-lived objects "
+	    "(default exp:10000).\n");
+    fprintf(stderr, "\trealloc=<p>     Fraction of objects grown by a "
+	    "realloc chain.\n");
+    fprintf(stderr, "\tchain=<n>       Reallocs per chain (default 4).\n");
+    fprintf(stderr, "\tgrowth=<f>      Growth factor per realloc "
+	    "(default 2).\n");
+    fprintf(stderr, "\tmaxlive=<n>     Free early to keep live bytes "
+	    "under <n>.\n");
+    fprintf(stderr, "\tout=<file>      Write the trace to <file> "
+	    "(default stdout).\n");
+}